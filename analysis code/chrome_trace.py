@@ -0,0 +1,328 @@
+#!/usr/bin/env python3
+"""Convert a plog trace to the Chrome trace event format.
+
+Copyright (c) 2018 Benjamin J. Andre
+
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v.  2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+The output opens in ui.perfetto.dev or chrome://tracing. Every plog id
+gets a track of its own, every CPU another one showing the jobs that
+started on it, and the events (overload, prediction, budget) are instants
+on their own tracks. A flow arrow links each sequencer cycle to the
+service jobs it released: the k-th release of a service on its semaphore
+starts its k-th job, and the sequencer releases service i on every cycle
+that is a multiple of its period.
+
+The trace is read twice, once to find the runs and the start of time and
+once to convert it, so memory does not grow with its length. A name ending
+in .gz is written compressed:
+
+    sudo src/laser-game.exe -s -n 18000 -t session.csv
+    analysis\\ code/chrome_trace.py session.csv -o session.json.gz
+
+"""
+
+from __future__ import print_function
+
+
+#
+# built-in modules
+#
+import argparse
+import gzip
+import json
+import sys
+import traceback
+
+#
+# other modules in this package
+#
+import plog_trace
+
+# pids of the two groups of tracks
+THREADS_PID = 1
+CPUS_PID = 2
+
+NSEC_PER_USEC = 1000.0
+
+
+# -------------------------------------------------------------------------------
+#
+# User input
+#
+# -------------------------------------------------------------------------------
+def commandline_options():
+    """Process the command line arguments.
+
+    """
+    parser = argparse.ArgumentParser(
+        description='Export a plog trace for the Perfetto or Chrome trace '
+        'viewers.')
+
+    parser.add_argument('--backtrace', action='store_true',
+                        help='show exception backtraces as extra debugging '
+                        'output')
+
+    parser.add_argument('--periods', default=None,
+                        help='sequencer ticks between releases of Service_1 '
+                        'to Service_3, comma separated, for traces of '
+                        'builds with other periods (default {0})'.format(
+                            ','.join(str(plog_trace.PERIOD_TICKS[s])
+                                     for s in sorted(plog_trace.PERIOD_TICKS))))
+
+    parser.add_argument('-o', '--output', default='trace.json',
+                        help='trace event file to write, compressed if the '
+                        'name ends in .gz')
+
+    parser.add_argument('trace', help='plog csv trace')
+
+    options = parser.parse_args()
+    return options
+
+
+# -------------------------------------------------------------------------------
+#
+# work functions
+#
+# -------------------------------------------------------------------------------
+def is_event(task):
+    return task in plog_trace.EVENT_NAMES
+
+
+def service_of(task):
+    """Service number 1 to 3 of a pipeline's plog id, 0 for the sequencer.
+
+    """
+    return task % plog_trace.PIPELINE_PLOG_STRIDE
+
+
+class RunCounter(object):
+    """Numbers the jobs of each plog id within its run.
+
+    results.csv holds one run after the other and each thread's records are
+    appended in a block, so a run of an id ends where its start time jumps
+    back or forward by more than plog_trace.RUN_GAP.
+
+    """
+
+    def __init__(self):
+        self.last = {}
+        self.run = {}
+        self.count = {}
+
+    def add(self, record):
+        """(run, job number from 1) of a job of record.id
+
+        """
+        task = record.id
+        last = self.last.get(task)
+        if last is None:
+            self.run[task] = 0
+            self.count[task] = 0
+        elif record.start < last or record.start - last > plog_trace.RUN_GAP:
+            self.run[task] += 1
+            self.count[task] = 0
+        self.last[task] = record.start
+        self.count[task] += 1
+        return self.run[task], self.count[task]
+
+
+def scan(filename):
+    """Start of time and the number of jobs of each (run, id) in the trace.
+
+    """
+    origin = None
+    present = {}
+    runs = RunCounter()
+
+    for record in plog_trace.read_entries(filename):
+        if origin is None or record.start < origin:
+            origin = record.start
+        if not is_event(record.id) and record.end > record.start:
+            run, job = runs.add(record)
+            present[(run, record.id)] = job
+
+    return origin, present
+
+
+def event_args(record):
+    """Decoded arg of an instantaneous event.
+
+    """
+    arg = int(record.extra[0]) if record.extra else 0
+    if record.id == 17:
+        return {'error_px': (arg & 0xffff) / 8.0,
+                'horizon_ms': (arg >> 16) & 0xff,
+                'player': arg >> 24}
+    if record.id == 18:
+        return {'service': arg & 0xff, 'cpu_us': arg >> 8}
+    return {'arg': arg}
+
+
+class TraceWriter(object):
+    """Streams trace events into a JSON object, naming tracks as they
+    first appear.
+
+    """
+
+    def __init__(self, out, origin):
+        self.out = out
+        self.origin = origin
+        self.first = True
+        self.named = set()
+        self.out.write('{"displayTimeUnit":"ms","traceEvents":[\n')
+        self.metadata(THREADS_PID, None, 'process_name', 'laser-game')
+        self.metadata(CPUS_PID, None, 'process_name', 'CPUs')
+
+    def ts(self, time):
+        return (time - self.origin) / NSEC_PER_USEC
+
+    def emit(self, event):
+        if not self.first:
+            self.out.write(',\n')
+        self.first = False
+        self.out.write(json.dumps(event, separators=(',', ':')))
+
+    def metadata(self, pid, tid, kind, name):
+        event = {'ph': 'M', 'pid': pid, 'name': kind, 'args': {'name': name}}
+        if tid is not None:
+            event['tid'] = tid
+        self.emit(event)
+
+    def track(self, pid, tid, name):
+        if (pid, tid) not in self.named:
+            self.named.add((pid, tid))
+            self.metadata(pid, tid, 'thread_name', name)
+            # keep the sequencer, services and events in plog id order
+            self.metadata(pid, tid, 'thread_sort_index', tid)
+
+    def job(self, record, cpu):
+        name = plog_trace.task_name(record.id)
+        event = {'ph': 'X', 'name': name, 'cat': 'job',
+                 'ts': self.ts(record.start),
+                 'dur': (record.end - record.start) / NSEC_PER_USEC,
+                 'pid': THREADS_PID, 'tid': record.id}
+        counters = plog_trace.counters(record)
+        if counters or cpu is not None:
+            event['args'] = dict(counters or {})
+            if cpu is not None:
+                event['args']['cpu'] = cpu
+
+        self.track(THREADS_PID, record.id, name)
+        self.emit(event)
+
+        if cpu is not None:
+            self.track(CPUS_PID, cpu, 'CPU {0}'.format(cpu))
+            event = dict(event, pid=CPUS_PID, tid=cpu)
+            self.emit(event)
+
+    def instant(self, record, cpu):
+        name = plog_trace.task_name(record.id)
+        event = {'ph': 'i', 's': 't', 'name': name, 'cat': 'event',
+                 'ts': self.ts(record.start), 'pid': THREADS_PID,
+                 'tid': record.id, 'args': event_args(record)}
+        if cpu is not None:
+            event['args']['cpu'] = cpu
+        self.track(THREADS_PID, record.id, name + ' events')
+        self.emit(event)
+
+    def flow(self, phase, key, time, tid):
+        event = {'ph': phase, 'id': key, 'name': 'release', 'cat': 'release',
+                 'ts': self.ts(time), 'pid': THREADS_PID, 'tid': tid}
+        if phase == 'f':
+            # bind to the job starting here rather than the enclosing one
+            event['bp'] = 'e'
+        self.emit(event)
+
+    def close(self):
+        self.out.write('\n]}\n')
+
+
+def flow_key(run, task, job):
+    return '{0}.{1}.{2}'.format(run, task, job)
+
+
+def convert(filename, writer, present, periods):
+    """Write the jobs, events and release flows of the trace.
+
+    """
+    runs = RunCounter()
+    jobs = events = 0
+
+    for record in plog_trace.read_entries(filename):
+        cpu = plog_trace.cpu(record)
+
+        if is_event(record.id):
+            writer.instant(record, cpu)
+            events += 1
+            continue
+        if record.end == record.start:
+            continue
+
+        run, job = runs.add(record)
+        writer.job(record, cpu)
+        jobs += 1
+
+        # a full plog buffer drops the last records of its thread, flows
+        # are only drawn where both ends were recorded
+        if record.id == 0:
+            # the services released by this cycle, in every pipeline that
+            # ran in this run
+            for service, period in periods.items():
+                if job % period != 0:
+                    continue
+                task = service
+                while (run, task) in present:
+                    if job // period <= present[(run, task)]:
+                        writer.flow('s', flow_key(run, task, job // period),
+                                    record.end - 1, 0)
+                    task += plog_trace.PIPELINE_PLOG_STRIDE
+        elif service_of(record.id) in periods:
+            period = periods[service_of(record.id)]
+            if job * period <= present.get((run, 0), 0):
+                writer.flow('f', flow_key(run, record.id, job), record.start,
+                            record.id)
+
+    return jobs, events
+
+
+# -------------------------------------------------------------------------------
+#
+# main
+#
+# -------------------------------------------------------------------------------
+def main(options):
+    periods = plog_trace.parse_periods(options.periods)
+
+    origin, present = scan(options.trace)
+    if origin is None:
+        print('{0}: no plog records'.format(options.trace))
+        return 1
+
+    if options.output.endswith('.gz'):
+        out = gzip.open(options.output, 'wt')
+    else:
+        out = open(options.output, 'w')
+    with out:
+        writer = TraceWriter(out, origin)
+        jobs, events = convert(options.trace, writer, present, periods)
+        writer.close()
+
+    print('{0}: {1} jobs and {2} events of {3} runs'.format(
+        options.output, jobs, events,
+        len(set(run for run, _ in present))))
+    return 0
+
+
+if __name__ == "__main__":
+    options = commandline_options()
+    try:
+        status = main(options)
+        sys.exit(status)
+    except Exception as error:
+        print(str(error))
+        if options.backtrace:
+            traceback.print_exc()
+        sys.exit(1)
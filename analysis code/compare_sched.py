@@ -0,0 +1,143 @@
+#!/usr/bin/env python3
+"""Compare release jitter and deadline misses of two plog traces.
+
+Copyright (c) 2018 Benjamin J. Andre
+
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v.  2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+Intended for a SCHED_FIFO run against a SCHED_DEADLINE run of the same
+configuration. Jitter is measured on the interval between consecutive job
+starts. A job counts as a miss when it is still running at its next nominal
+release (response longer than the median period), and a release interval
+longer than 1.5 periods counts as a skipped job.
+
+"""
+
+from __future__ import print_function
+
+
+#
+# built-in modules
+#
+import argparse
+import math
+import sys
+import traceback
+
+#
+# other modules in this package
+#
+import plog_trace
+
+NSEC_PER_MSEC = float(plog_trace.NSEC_PER_MSEC)
+
+
+# -------------------------------------------------------------------------------
+#
+# User input
+#
+# -------------------------------------------------------------------------------
+def commandline_options():
+    """Process the command line arguments.
+
+    """
+    parser = argparse.ArgumentParser(
+        description='Compare jitter and miss rates of two plog traces.')
+
+    parser.add_argument('--backtrace', action='store_true',
+                        help='show exception backtraces as extra debugging '
+                        'output')
+
+    parser.add_argument('--labels', nargs=2, default=['FIFO', 'DEADLINE'],
+                        help='names of the two runs in the report')
+
+    parser.add_argument('traces', nargs=2,
+                        help='plog csv traces to compare')
+
+    options = parser.parse_args()
+    return options
+
+
+# -------------------------------------------------------------------------------
+#
+# work functions
+#
+# -------------------------------------------------------------------------------
+def task_summary(records):
+    """Jitter and miss statistics for the jobs of one task.
+
+    """
+    intervals = plog_trace.periods(records)
+    period = plog_trace.median(intervals)
+    exec_times = sorted(plog_trace.execution_times(records))
+
+    mean = sum(intervals) / float(len(intervals))
+    std = math.sqrt(sum((i - mean) ** 2 for i in intervals) / len(intervals))
+    worst = max(abs(i - period) for i in intervals)
+
+    late = sum(1 for t in exec_times if t > period)
+    skipped = sum(1 for i in intervals if i > 1.5 * period)
+
+    return {
+        'jobs': len(records),
+        'period': period / NSEC_PER_MSEC,
+        'jitter_std': std / NSEC_PER_MSEC,
+        'jitter_max': worst / NSEC_PER_MSEC,
+        'median': plog_trace.percentile(exec_times, 50.0) / NSEC_PER_MSEC,
+        'p99': plog_trace.percentile(exec_times, 99.0) / NSEC_PER_MSEC,
+        'wcet': exec_times[-1] / NSEC_PER_MSEC,
+        'miss_rate': 100.0 * (late + skipped) / (len(records) + skipped),
+    }
+
+
+def print_report(labels, summaries):
+    header = ('{0:<10} {1:<9} {2:>6} {3:>9} {4:>10} {5:>10} {6:>9} '
+              '{7:>9} {8:>9} {9:>7}')
+    row = ('{0:<10} {1:<9} {jobs:>6d} {period:>9.3f} {jitter_std:>10.3f} '
+           '{jitter_max:>10.3f} {median:>9.3f} {p99:>9.3f} {wcet:>9.3f} '
+           '{miss_rate:>6.2f}%')
+
+    print(header.format('task', 'run', 'jobs', 'period', 'jitter_sd',
+                        'jitter_max', 'median', 'p99', 'wcet', 'miss'))
+    print(header.format('', '', '', '(ms)', '(ms)', '(ms)', '(ms)', '(ms)',
+                        '(ms)', ''))
+    tasks = sorted(set(summaries[0].keys()) | set(summaries[1].keys()))
+    for task in tasks:
+        for label, summary in zip(labels, summaries):
+            if task in summary:
+                print(row.format(plog_trace.task_name(task), label,
+                                 **summary[task]))
+            else:
+                print('{0:<10} {1:<9} no jobs'.format(
+                    plog_trace.task_name(task), label))
+
+
+# -------------------------------------------------------------------------------
+#
+# main
+#
+# -------------------------------------------------------------------------------
+def main(options):
+    summaries = []
+    for trace in options.traces:
+        tasks = plog_trace.load_by_id(trace)
+        summaries.append(dict((task, task_summary(records))
+                              for task, records in tasks.items()
+                              if len(records) > 2))
+
+    print_report(options.labels, summaries)
+    return 0
+
+
+if __name__ == "__main__":
+    options = commandline_options()
+    try:
+        status = main(options)
+        sys.exit(status)
+    except Exception as error:
+        print(str(error))
+        if options.backtrace:
+            traceback.print_exc()
+        sys.exit(1)
@@ -0,0 +1,112 @@
+#!/usr/bin/env python3
+"""Derive SCHED_DEADLINE parameters from a measured plog trace.
+
+Copyright (c) 2018 Benjamin J. Andre
+
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v.  2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+The runtime of each task is its measured WCET times a safety margin, the
+period is the median release period and the deadline is implicit (equal to
+the period). The output is the parameter file read by laser-game -d.
+
+"""
+
+from __future__ import print_function
+
+
+#
+# built-in modules
+#
+import argparse
+import math
+import sys
+import traceback
+
+#
+# other modules in this package
+#
+import plog_trace
+
+# the kernel rejects runtimes below 1 << 10 nsec
+MIN_RUNTIME = 1024
+
+
+# -------------------------------------------------------------------------------
+#
+# User input
+#
+# -------------------------------------------------------------------------------
+def commandline_options():
+    """Process the command line arguments.
+
+    """
+    parser = argparse.ArgumentParser(
+        description='Derive SCHED_DEADLINE parameters from a plog trace.')
+
+    parser.add_argument('--backtrace', action='store_true',
+                        help='show exception backtraces as extra debugging '
+                        'output')
+
+    parser.add_argument('--margin', type=float, default=1.25,
+                        help='runtime as a multiple of the measured WCET')
+
+    parser.add_argument('--cpus', type=int, default=1,
+                        help='number of cpus in the root domain, used to '
+                        'check the total bandwidth')
+
+    parser.add_argument('--ids', type=int, nargs='+', default=[1, 2, 3],
+                        help='plog ids to run under SCHED_DEADLINE')
+
+    parser.add_argument('trace', help='plog csv trace from a SCHED_FIFO run')
+
+    options = parser.parse_args()
+    return options
+
+
+# -------------------------------------------------------------------------------
+#
+# main
+#
+# -------------------------------------------------------------------------------
+def main(options):
+    tasks = plog_trace.load_by_id(options.trace)
+
+    print('# id, runtime_ns, deadline_ns, period_ns')
+    print('# from {0}, margin {1}'.format(options.trace, options.margin))
+
+    bandwidth = 0.0
+    for task in options.ids:
+        records = tasks.get(task, [])
+        if len(records) < 2:
+            print('no jobs for {0} in trace'.format(
+                plog_trace.task_name(task)), file=sys.stderr)
+            continue
+        wcet = max(plog_trace.execution_times(records))
+        period = plog_trace.median(plog_trace.periods(records))
+        runtime = max(MIN_RUNTIME, int(math.ceil(wcet * options.margin)))
+        runtime = min(runtime, period)
+        bandwidth += float(runtime) / period
+        print('{0}, {1}, {2}, {3}'.format(task, runtime, period, period))
+
+    print('# total bandwidth {0:.3f} on {1} cpus'.format(bandwidth,
+                                                        options.cpus))
+    if bandwidth > options.cpus:
+        print('WARNING: total bandwidth {0:.3f} exceeds {1} cpus, the kernel '
+              'will refuse the parameters'.format(bandwidth, options.cpus),
+              file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    options = commandline_options()
+    try:
+        status = main(options)
+        sys.exit(status)
+    except Exception as error:
+        print(str(error))
+        if options.backtrace:
+            traceback.print_exc()
+        sys.exit(1)
@@ -0,0 +1,199 @@
+#!/usr/bin/env python3
+"""Check a plog trace for timing regressions against a stored baseline.
+
+Copyright (c) 2018 Benjamin J. Andre
+
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v.  2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+Both traces should come from the same replayed workload, e.g.
+
+    sudo src/laser-game.exe -r recorded.avi -n 900 -t new.csv
+
+The median, p99 and WCET execution time of every task in the baseline are
+compared with the new trace. A metric regresses when it exceeds the
+baseline by more than its tolerance band, a percentage of the baseline plus
+a small absolute slack so sub-millisecond tasks do not fail on timer noise.
+A task of the baseline without enough jobs in the new trace also fails.
+The exit status is nonzero when anything regressed.
+
+"""
+
+from __future__ import print_function
+
+
+#
+# built-in modules
+#
+import argparse
+import sys
+import traceback
+
+#
+# other modules in this package
+#
+import plog_trace
+
+NSEC_PER_MSEC = float(plog_trace.NSEC_PER_MSEC)
+
+METRICS = ['median', 'p99', 'wcet']
+
+# default tolerance of each metric in percent of the baseline, the tails
+# of a replay are noisier than its median
+DEFAULT_TOLERANCE = {
+    'median': 10.0,
+    'p99': 20.0,
+    'wcet': 35.0,
+}
+
+
+# -------------------------------------------------------------------------------
+#
+# User input
+#
+# -------------------------------------------------------------------------------
+def commandline_options():
+    """Process the command line arguments.
+
+    """
+    parser = argparse.ArgumentParser(
+        description='Compare execution times of a plog trace against a '
+        'baseline trace and fail on regressions.')
+
+    parser.add_argument('--backtrace', action='store_true',
+                        help='show exception backtraces as extra debugging '
+                        'output')
+
+    for metric in METRICS:
+        parser.add_argument('--{0}-tolerance'.format(metric), type=float,
+                            default=DEFAULT_TOLERANCE[metric],
+                            dest='{0}_tolerance'.format(metric),
+                            help='allowed {0} increase in percent '
+                            '(default {1:g})'.format(
+                                metric, DEFAULT_TOLERANCE[metric]))
+
+    parser.add_argument('--slack', type=float, default=0.05,
+                        help='absolute slack added to every band in ms '
+                        '(default 0.05)')
+
+    parser.add_argument('--min-jobs', type=int, default=30,
+                        help='jobs a task needs in the new trace '
+                        '(default 30)')
+
+    parser.add_argument('baseline',
+                        help='plog csv trace of the baseline build')
+
+    parser.add_argument('trace',
+                        help='plog csv trace of the build under test')
+
+    options = parser.parse_args()
+    return options
+
+
+# -------------------------------------------------------------------------------
+#
+# work functions
+#
+# -------------------------------------------------------------------------------
+def task_metrics(records):
+    """Median, p99 and WCET execution time of one task in ms.
+
+    """
+    exec_times = sorted(plog_trace.execution_times(records))
+    return {
+        'jobs': len(exec_times),
+        'median': plog_trace.percentile(exec_times, 50.0) / NSEC_PER_MSEC,
+        'p99': plog_trace.percentile(exec_times, 99.0) / NSEC_PER_MSEC,
+        'wcet': exec_times[-1] / NSEC_PER_MSEC,
+    }
+
+
+def load_metrics(filename):
+    tasks = plog_trace.load_by_id(filename)
+    return dict((task, task_metrics(records))
+                for task, records in tasks.items() if records)
+
+
+def compare(baseline, current, options):
+    """Rows of (task, metric, baseline, current, limit, ok), and the count
+    of regressions.
+
+    """
+    rows = []
+    regressions = 0
+
+    for task in sorted(baseline.keys()):
+        base = baseline[task]
+        new = current.get(task)
+
+        if new is None or new['jobs'] < options.min_jobs:
+            rows.append((task, 'jobs', base['jobs'],
+                         new['jobs'] if new else 0, options.min_jobs, False))
+            regressions += 1
+            continue
+
+        for metric in METRICS:
+            tolerance = getattr(options, '{0}_tolerance'.format(metric))
+            limit = base[metric] * (1.0 + tolerance / 100.0) + options.slack
+            ok = new[metric] <= limit
+            if not ok:
+                regressions += 1
+            rows.append((task, metric, base[metric], new[metric], limit, ok))
+
+    return rows, regressions
+
+
+def print_report(rows):
+    header = '{0:<10} {1:<7} {2:>10} {3:>10} {4:>10} {5:>8}  {6}'
+    row = '{0:<10} {1:<7} {2:>10.3f} {3:>10.3f} {4:>10.3f} {5:>+7.1f}%  {6}'
+
+    print(header.format('task', 'metric', 'baseline', 'current', 'limit',
+                        'change', 'result'))
+    print(header.format('', '', '(ms)', '(ms)', '(ms)', '', ''))
+    for task, metric, base, new, limit, ok in rows:
+        result = 'ok' if ok else 'REGRESSED'
+        if metric == 'jobs':
+            print('{0:<10} {1:<7} {2:>10d} {3:>10d} {4:>10d} {5:>8}  '
+                  '{6}'.format(plog_trace.task_name(task), metric, base, new,
+                               limit, '', result))
+            continue
+        change = 100.0 * (new - base) / base if base > 0 else 0.0
+        print(row.format(plog_trace.task_name(task), metric, base, new, limit,
+                         change, result))
+
+
+# -------------------------------------------------------------------------------
+#
+# main
+#
+# -------------------------------------------------------------------------------
+def main(options):
+    baseline = load_metrics(options.baseline)
+    current = load_metrics(options.trace)
+
+    if not baseline:
+        raise RuntimeError('no jobs in baseline {0}'.format(options.baseline))
+
+    rows, regressions = compare(baseline, current, options)
+    print_report(rows)
+
+    if regressions:
+        print('\n{0} regression(s) against {1}'.format(regressions,
+                                                       options.baseline))
+        return 1
+
+    print('\nno regressions against {0}'.format(options.baseline))
+    return 0
+
+
+if __name__ == "__main__":
+    options = commandline_options()
+    try:
+        status = main(options)
+        sys.exit(status)
+    except Exception as error:
+        print(str(error))
+        if options.backtrace:
+            traceback.print_exc()
+        sys.exit(1)
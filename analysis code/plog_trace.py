@@ -0,0 +1,229 @@
+"""Read plog csv traces written by csvAppendPlogBuff.
+
+Copyright (c) 2018 Benjamin J. Andre
+
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v.  2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+Each line is "id, start, end, arg, counters..., cpu" with timestamps printed
+as sec.nsec, older traces stop after end or after the counters. Times are
+kept as integer nanoseconds so no precision is lost to floating point.
+
+"""
+
+from __future__ import print_function
+
+import collections
+
+NSEC_PER_SEC = 1000000000
+NSEC_PER_MSEC = 1000000
+
+# results.csv is appended to by every run, a gap this long between two jobs
+# of the same task is a boundary between runs rather than a late release
+RUN_GAP = 10 * NSEC_PER_SEC
+
+# plog ids of the sequencer and services
+TASK_NAMES = {
+    0: 'Sequencer',
+    1: 'Service_1',
+    2: 'Service_2',
+    3: 'Service_3',
+}
+
+# services of pipeline p log under id + p * PIPELINE_PLOG_STRIDE
+PIPELINE_PLOG_STRIDE = 4
+
+# plog ids of instantaneous events, see overload.hpp, pipeline.hpp and
+# budget.hpp
+EVENT_NAMES = {
+    16: 'overload',
+    17: 'prediction',
+    18: 'budget',
+}
+
+# sequencer ticks between releases of each service, S<id>_PERIOD_TICKS in
+# constants.hpp
+PERIOD_TICKS = {
+    1: 3,
+    2: 4,
+    3: 5,
+}
+
+# SEQUENCER_PERIOD_NSEC in constants.hpp, 30 Hz
+SEQUENCER_PERIOD = 33333333
+
+Record = collections.namedtuple('Record', ['id', 'start', 'end', 'extra'])
+
+# columns after end: the event arg, the perfctr_t counters and the cpu
+COUNTER_NAMES = ['instructions', 'cycles', 'llc_misses', 'ctx_switches',
+                 'page_faults']
+CPU_COLUMN = 1 + len(COUNTER_NAMES)
+
+
+def parse_timestamp(text):
+    """Convert a sec.nsec timestamp into integer nanoseconds.
+
+    """
+    text = text.strip()
+    if '.' not in text:
+        return int(text) * NSEC_PER_SEC
+    sec, nsec = text.split('.', 1)
+    nsec = (nsec + '000000000')[:9]
+    return int(sec) * NSEC_PER_SEC + int(nsec)
+
+
+def read_plog(filename):
+    """Generate the valid records of a trace in file order.
+
+    Entries that were never started or finished, or that ran backwards, are
+    skipped the same way analysis.m prunes them. Columns after end are
+    returned unparsed in extra.
+
+    """
+    with open(filename) as trace:
+        for line in trace:
+            fields = line.split(',')
+            if len(fields) < 3:
+                continue
+            try:
+                task = int(fields[0])
+                start = parse_timestamp(fields[1])
+                end = parse_timestamp(fields[2])
+            except ValueError:
+                continue
+            if start == 0 or end == 0 or end <= start:
+                continue
+            yield Record(task, start, end,
+                         [field.strip() for field in fields[3:]])
+
+
+def read_events(filename, task):
+    """Generate (time, arg) of the instantaneous events with plog id task,
+    which read_plog skips because they start and end at the same time.
+
+    """
+    with open(filename) as trace:
+        for line in trace:
+            fields = line.split(',')
+            if len(fields) < 4:
+                continue
+            try:
+                if int(fields[0]) != task:
+                    continue
+                time = parse_timestamp(fields[1])
+                arg = int(fields[3])
+            except ValueError:
+                continue
+            if time == 0:
+                continue
+            yield time, arg
+
+
+def read_entries(filename):
+    """Generate the jobs and the instantaneous events of a trace in file
+    order, events being records that end when they start.
+
+    """
+    with open(filename) as trace:
+        for line in trace:
+            fields = line.split(',')
+            if len(fields) < 3:
+                continue
+            try:
+                task = int(fields[0])
+                start = parse_timestamp(fields[1])
+                end = parse_timestamp(fields[2])
+            except ValueError:
+                continue
+            if start == 0 or end < start:
+                continue
+            yield Record(task, start, end,
+                         [field.strip() for field in fields[3:]])
+
+
+def load_by_id(filename):
+    """Group a trace into per task lists of records sorted by start time.
+
+    """
+    tasks = collections.defaultdict(list)
+    for record in read_plog(filename):
+        tasks[record.id].append(record)
+    for records in tasks.values():
+        records.sort(key=lambda r: r.start)
+    return tasks
+
+
+def percentile(sorted_values, pct):
+    """Nearest rank percentile of an already sorted list.
+
+    """
+    if not sorted_values:
+        return 0
+    rank = int(round(pct / 100.0 * (len(sorted_values) - 1)))
+    return sorted_values[max(0, min(rank, len(sorted_values) - 1))]
+
+
+def median(values):
+    return percentile(sorted(values), 50.0)
+
+
+def task_name(task):
+    if task in TASK_NAMES:
+        return TASK_NAMES[task]
+    if task in EVENT_NAMES:
+        return EVENT_NAMES[task]
+    pipeline, service = divmod(task, PIPELINE_PLOG_STRIDE)
+    if service in TASK_NAMES and service > 0:
+        return 'P{0} {1}'.format(pipeline, TASK_NAMES[service])
+    return 'task {0}'.format(task)
+
+
+def cpu(record):
+    """CPU a record started on, None for traces from before it was
+    recorded.
+
+    """
+    if len(record.extra) <= CPU_COLUMN:
+        return None
+    value = int(record.extra[CPU_COLUMN])
+    return value if value >= 0 else None
+
+
+def counters(record):
+    """Performance counters of a record as a dict, None if not recorded.
+
+    """
+    values = record.extra[1:1 + len(COUNTER_NAMES)]
+    if len(values) < len(COUNTER_NAMES):
+        return None
+    values = [int(v) for v in values]
+    if not any(values):
+        return None
+    return dict(zip(COUNTER_NAMES, values))
+
+
+def parse_periods(text):
+    """Service number to sequencer ticks from a --periods option listing the
+    ticks of Service_1 to Service_3, PERIOD_TICKS when not given.
+
+    """
+    if text is None:
+        return dict(PERIOD_TICKS)
+    values = [int(v) for v in text.split(',')]
+    if len(values) != len(PERIOD_TICKS) or min(values) < 1:
+        raise ValueError('--periods needs {0} positive tick counts'.format(
+            len(PERIOD_TICKS)))
+    return dict(zip(sorted(PERIOD_TICKS), values))
+
+
+def execution_times(records):
+    return [r.end - r.start for r in records]
+
+
+def periods(records):
+    """Intervals between consecutive job starts within the same run.
+
+    """
+    return [b.start - a.start for a, b in zip(records, records[1:])
+            if b.start - a.start < RUN_GAP]
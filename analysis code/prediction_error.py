@@ -0,0 +1,137 @@
+#!/usr/bin/env python3
+"""Summarize the player prediction error events of a plog trace.
+
+Copyright (c) 2018 Benjamin J. Andre
+
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v.  2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+The tracking service logs one PLOG_ID_PREDICTION event per tracked
+detection: how far the detection was from where the track predicted it
+for its capture time, and how long since the previous detection. The error
+over that horizon bounds what extrapolating further, to the display time
+set with laser-game -L, can achieve, so the latency can be tuned against
+it:
+
+    sudo src/laser-game.exe -s -n 900 -L 30 -t predict.csv
+    analysis\\ code/prediction_error.py predict.csv
+
+"""
+
+from __future__ import print_function
+
+
+#
+# built-in modules
+#
+import argparse
+import collections
+import sys
+import traceback
+
+#
+# other modules in this package
+#
+import plog_trace
+
+# pipeline.hpp
+PLOG_ID_PREDICTION = 17
+ERROR_SCALE = 8.0
+
+# width of the horizon buckets in ms
+HORIZON_BUCKET = 50
+
+
+# -------------------------------------------------------------------------------
+#
+# User input
+#
+# -------------------------------------------------------------------------------
+def commandline_options():
+    """Process the command line arguments.
+
+    """
+    parser = argparse.ArgumentParser(
+        description='Prediction error of the player tracks in a plog trace.')
+
+    parser.add_argument('--backtrace', action='store_true',
+                        help='show exception backtraces as extra debugging '
+                        'output')
+
+    parser.add_argument('trace',
+                        help='plog csv trace of the game')
+
+    options = parser.parse_args()
+    return options
+
+
+# -------------------------------------------------------------------------------
+#
+# work functions
+#
+# -------------------------------------------------------------------------------
+def decode(arg):
+    """(player, error in pixels, horizon in ms) of an event arg.
+
+    """
+    return ((arg >> 24) & 0xff, (arg & 0xffff) / ERROR_SCALE,
+            (arg >> 16) & 0xff)
+
+
+def summarize(errors):
+    errors = sorted(errors)
+    return (len(errors), plog_trace.percentile(errors, 50.0),
+            plog_trace.percentile(errors, 95.0), errors[-1])
+
+
+def print_table(title, groups):
+    header = '{0:<12} {1:>8} {2:>10} {3:>10} {4:>10}'
+    row = '{0:<12} {1:>8d} {2:>10.2f} {3:>10.2f} {4:>10.2f}'
+
+    print(title)
+    print(header.format('', 'n', 'median', 'p95', 'max'))
+    print(header.format('', '', '(px)', '(px)', '(px)'))
+    for name, errors in groups:
+        print(row.format(name, *summarize(errors)))
+    print()
+
+
+# -------------------------------------------------------------------------------
+#
+# main
+#
+# -------------------------------------------------------------------------------
+def main(options):
+    players = collections.defaultdict(list)
+    horizons = collections.defaultdict(list)
+
+    for _, arg in plog_trace.read_events(options.trace, PLOG_ID_PREDICTION):
+        player, error, horizon = decode(arg)
+        players[player].append(error)
+        # the first detection of a track has nothing to be predicted from
+        if horizon > 0:
+            horizons[horizon // HORIZON_BUCKET].append(error)
+
+    if not players:
+        raise RuntimeError('no prediction events in {0}'.format(
+            options.trace))
+
+    print_table('by player', [('player {0}'.format(p), players[p])
+                              for p in sorted(players)])
+    print_table('by horizon', [
+        ('{0}-{1} ms'.format(b * HORIZON_BUCKET, (b + 1) * HORIZON_BUCKET),
+         horizons[b]) for b in sorted(horizons)])
+    return 0
+
+
+if __name__ == "__main__":
+    options = commandline_options()
+    try:
+        status = main(options)
+        sys.exit(status)
+    except Exception as error:
+        print(str(error))
+        if options.backtrace:
+            traceback.print_exc()
+        sys.exit(1)
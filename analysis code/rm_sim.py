@@ -0,0 +1,385 @@
+#!/usr/bin/env python3
+"""Simulate SCHED_FIFO rate monotonic scheduling of a what-if configuration.
+
+Copyright (c) 2018 Benjamin J. Andre
+
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v.  2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+Execution times are drawn at random from the ones measured in a plog trace,
+and the service set is the one the sequencer runs, with the service periods
+given in sequencer ticks (--periods), more pipelines (--pipelines) or extra
+services that take the execution times of a measured one (--add). The
+sequencer runs every tick at the highest priority and releases service i
+when it finishes a cycle whose count, from 1, is a multiple of its period.
+Services are prioritized by period, the shorter the higher, equal periods
+share a priority and run first come first served. A service still busy
+when released again runs the new job as soon as the old one finishes, like
+the semaphore count of the real thread.
+
+On more than one cpu the highest priority ready jobs run on the free cpus
+their affinity allows; --pinned restricts the services of each pipeline to
+its share of the cpus like laser-game -p. A job misses when it finishes
+more than a period after its tick.
+
+The measured times are end minus start, so they include any preemption the
+traced run saw and the prediction errs on the pessimistic side. Jobs are
+drawn independently of each other, a trace whose slow jobs come in bursts
+misses more often than predicted.
+
+    analysis\\ code/rm_sim.py session.csv --periods 2,4,6
+    analysis\\ code/rm_sim.py session.csv --pipelines 2 --cpus 2 --pinned
+
+"""
+
+from __future__ import print_function
+
+
+#
+# built-in modules
+#
+import argparse
+import bisect
+import collections
+import random
+import sys
+import traceback
+
+#
+# other modules in this package
+#
+import plog_trace
+
+NSEC_PER_MSEC = float(plog_trace.NSEC_PER_MSEC)
+NSEC_PER_SEC = float(plog_trace.NSEC_PER_SEC)
+
+# percentiles of the response time in the report
+RESPONSE_PERCENTILES = [50.0, 90.0, 99.0, 99.9]
+
+SimTask = collections.namedtuple('SimTask',
+                                 ['name', 'source', 'ticks', 'cpus'])
+
+
+# -------------------------------------------------------------------------------
+#
+# User input
+#
+# -------------------------------------------------------------------------------
+def commandline_options():
+    """Process the command line arguments.
+
+    """
+    parser = argparse.ArgumentParser(
+        description='Predict response times and deadline misses of a '
+        'service configuration from the execution times of a plog trace. '
+        'Exits with 1 when a task misses.')
+
+    parser.add_argument('--backtrace', action='store_true',
+                        help='show exception backtraces as extra debugging '
+                        'output')
+
+    parser.add_argument('--periods', default=None,
+                        help='sequencer ticks between releases of Service_1 '
+                        'to Service_3, comma separated (default {0})'.format(
+                            ','.join(str(plog_trace.PERIOD_TICKS[s])
+                                     for s in sorted(plog_trace.PERIOD_TICKS))))
+
+    parser.add_argument('--tick-ms', type=float,
+                        default=plog_trace.SEQUENCER_PERIOD / NSEC_PER_MSEC,
+                        help='sequencer period (default %(default).3f)')
+
+    parser.add_argument('--pipelines', type=int, default=1,
+                        help='pipelines of three services, each with the '
+                        'execution times of its own plog ids when the trace '
+                        'has them and of the first pipeline otherwise')
+
+    parser.add_argument('--add', action='append', default=[],
+                        metavar='ID:TICKS',
+                        help='an extra service released every TICKS ticks '
+                        'that takes the execution times of plog id ID, may '
+                        'be repeated')
+
+    parser.add_argument('--scale', type=float, default=1.0,
+                        help='multiply every execution time, e.g. 4 for '
+                        'twice the resolution')
+
+    parser.add_argument('--cpus', type=int, default=1,
+                        help='cpus the sequencer and services run on')
+
+    parser.add_argument('--pinned', action='store_true',
+                        help='restrict the services of each pipeline to '
+                        'its share of the cpus')
+
+    parser.add_argument('--hyperperiods', type=int, default=1000,
+                        help='hyperperiods to simulate')
+
+    parser.add_argument('--seed', type=int, default=1,
+                        help='seed of the execution time draws')
+
+    parser.add_argument('-o', '--output', default=None,
+                        help='write every simulated job as task, release '
+                        '(s), response (ms), missed to this csv file')
+
+    parser.add_argument('trace', help='plog csv trace to take the execution '
+                        'times from')
+
+    options = parser.parse_args()
+    return options
+
+
+# -------------------------------------------------------------------------------
+#
+# work functions
+#
+# -------------------------------------------------------------------------------
+def gcd(a, b):
+    while b:
+        a, b = b, a % b
+    return a
+
+
+def partition_cpus(p, pipelines, cpus):
+    """Cpus of pipeline p, the same split as partition_cpus in main.cpp.
+
+    """
+    if pipelines > cpus:
+        return frozenset([p % cpus])
+    return frozenset(range(p * cpus // pipelines,
+                           (p + 1) * cpus // pipelines))
+
+
+def build_tasks(options, periods, measured):
+    """The sequencer first, then the services of each pipeline and the
+    extra ones.
+
+    """
+    tasks = [SimTask('Sequencer', 0, 1, None)]
+
+    for p in range(options.pipelines):
+        cpus = None
+        if options.pinned:
+            cpus = partition_cpus(p, options.pipelines, options.cpus)
+        for service, ticks in sorted(periods.items()):
+            task = service + p * plog_trace.PIPELINE_PLOG_STRIDE
+            source = task if task in measured else service
+            tasks.append(SimTask(plog_trace.task_name(task), source, ticks,
+                                 cpus))
+
+    for n, text in enumerate(options.add):
+        source, ticks = [int(v) for v in text.split(':')]
+        if ticks < 1:
+            raise ValueError('--add {0}: TICKS must be positive'.format(text))
+        tasks.append(SimTask('Extra_{0} ({1})'.format(
+            n + 1, plog_trace.task_name(source)), source, ticks, None))
+
+    for task in tasks:
+        if task.source not in measured:
+            raise ValueError('no jobs of {0} in {1}'.format(
+                plog_trace.task_name(task.source), options.trace))
+    return tasks
+
+
+class Simulator(object):
+    """Event driven fixed priority scheduler over integer nanoseconds.
+
+    Each task is one thread with a queue of released jobs, [nominal release,
+    remaining time], of which only the oldest can run.
+
+    """
+
+    def __init__(self, tasks, samples, cpus, tick, rng):
+        self.tasks = tasks
+        self.samples = samples
+        self.cpus = cpus
+        self.tick = tick
+        self.rng = rng
+
+        # the sequencer above everything, then rate monotonic
+        self.priority = [(i > 0, task.ticks) for i, task in enumerate(tasks)]
+        self.queues = [collections.deque() for _ in tasks]
+        # when the thread last became ready, first come first served among
+        # equal priorities
+        self.ready = [0] * len(tasks)
+        self.responses = [[] for _ in tasks]
+        self.first_miss = [None] * len(tasks)
+        self.on_job = None
+
+    def release(self, i, nominal, now):
+        draw = self.rng.choice(self.samples[self.tasks[i].source])
+        if not self.queues[i]:
+            self.ready[i] = now
+        self.queues[i].append([nominal, draw])
+
+    def complete(self, i, now):
+        nominal, _ = self.queues[i].popleft()
+        response = now - nominal
+        deadline = self.tasks[i].ticks * self.tick
+        self.responses[i].append(response)
+        if response > deadline and self.first_miss[i] is None:
+            self.first_miss[i] = now
+        if self.on_job is not None:
+            self.on_job(i, nominal, response, response > deadline)
+
+        # a busy thread finds its semaphore already posted and keeps going
+        if i == 0:
+            count = nominal // self.tick + 1
+            for j in range(1, len(self.tasks)):
+                if count % self.tasks[j].ticks == 0:
+                    self.release(j, nominal, now)
+
+    def pick(self):
+        """Tasks running until the next event.
+
+        """
+        ready = [i for i in range(len(self.tasks)) if self.queues[i]]
+        ready.sort(key=lambda i: (self.priority[i], self.ready[i], i))
+
+        free = set(range(self.cpus))
+        running = []
+        for i in ready:
+            allowed = free
+            if self.tasks[i].cpus is not None:
+                allowed = free & self.tasks[i].cpus
+            if allowed:
+                free.discard(min(allowed))
+                running.append(i)
+                if not free:
+                    break
+        return running
+
+    def run(self, ticks):
+        """Release the sequencer ticks times and run until every job is
+        done, returns the simulated time.
+
+        """
+        now = 0
+        released = 0
+
+        while True:
+            if released < ticks and now == released * self.tick:
+                self.release(0, now, now)
+                released += 1
+
+            next_tick = released * self.tick if released < ticks else None
+            running = self.pick()
+            if not running:
+                if next_tick is None:
+                    return now
+                now = next_tick
+                continue
+
+            step = min(self.queues[i][0][1] for i in running)
+            if next_tick is not None:
+                step = min(step, next_tick - now)
+            now += step
+
+            for i in running:
+                job = self.queues[i][0]
+                job[1] -= step
+                if job[1] == 0:
+                    self.complete(i, now)
+
+
+def execution_samples(filename, scale):
+    """Measured execution times of each plog id in integer nanoseconds.
+
+    """
+    samples = {}
+    for task, records in plog_trace.load_by_id(filename).items():
+        samples[task] = [max(1, int(round(t * scale)))
+                         for t in plog_trace.execution_times(records)]
+    return samples
+
+
+def print_report(sim, tasks, seconds):
+    header = ('{0:<22} {1:>7} {2:>6} {3:>7} {4:>8} {5:>8} {6:>8} {7:>8} '
+              '{8:>8} {9:>7} {10:>8} {11:>9} {12:>10}')
+    row = ('{0:<22} {1:>7.1f} {2:>6.3f} {3:>7d} {4:>8.2f} {5:>8.2f} '
+           '{6:>8.2f} {7:>8.2f} {8:>8.2f} {9:>7d} {10:>7.3f}% {11:>9.4f} '
+           '{12:>10}')
+
+    print(header.format('task', 'period', 'util', 'jobs', 'p50', 'p90',
+                        'p99', 'p99.9', 'max', 'misses', 'miss', 'misses/s',
+                        'first_miss'))
+    print(header.format('', '(ms)', '', '', '(ms)', '(ms)', '(ms)', '(ms)',
+                        '(ms)', '', '', '', '(s)'))
+
+    for i, task in enumerate(tasks):
+        responses = sorted(sim.responses[i])
+        period = task.ticks * sim.tick
+        draws = sim.samples[task.source]
+        util = sum(draws) / float(len(draws)) / period
+        misses = len(responses) - bisect.bisect_right(responses, period)
+        first = sim.first_miss[i]
+
+        values = [plog_trace.percentile(responses, p) / NSEC_PER_MSEC
+                  for p in RESPONSE_PERCENTILES]
+        print(row.format(task.name, period / NSEC_PER_MSEC, util,
+                         len(responses), *values +
+                         [responses[-1] / NSEC_PER_MSEC if responses else 0.0,
+                          misses, 100.0 * misses / max(1, len(responses)),
+                          misses / seconds,
+                          '-' if first is None else
+                          '{0:.2f}'.format(first / NSEC_PER_SEC)]))
+
+
+# -------------------------------------------------------------------------------
+#
+# main
+#
+# -------------------------------------------------------------------------------
+def main(options):
+    if options.cpus < 1 or options.pipelines < 1 or options.hyperperiods < 1:
+        raise ValueError('--cpus, --pipelines and --hyperperiods must be '
+                         'positive')
+
+    periods = plog_trace.parse_periods(options.periods)
+    samples = execution_samples(options.trace, options.scale)
+    tasks = build_tasks(options, periods, samples)
+    tick = int(round(options.tick_ms * NSEC_PER_MSEC))
+
+    hyperperiod = 1
+    for task in tasks:
+        hyperperiod = hyperperiod * task.ticks // gcd(hyperperiod, task.ticks)
+    ticks = hyperperiod * options.hyperperiods
+    seconds = ticks * tick / NSEC_PER_SEC
+
+    sim = Simulator(tasks, samples, options.cpus, tick,
+                    random.Random(options.seed))
+
+    out = None
+    if options.output is not None:
+        out = open(options.output, 'w')
+        out.write('task,release_s,response_ms,missed\n')
+        sim.on_job = lambda i, nominal, response, missed: out.write(
+            '{0},{1:.6f},{2:.3f},{3:d}\n'.format(
+                tasks[i].name, nominal / NSEC_PER_SEC,
+                response / NSEC_PER_MSEC, missed))
+    try:
+        sim.run(ticks)
+    finally:
+        if out is not None:
+            out.close()
+
+    print('# {0} hyperperiods of {1} ticks, {2:.1f} s, on {3} cpus{4}, '
+          'execution times from {5} x {6:g}'.format(
+              options.hyperperiods, hyperperiod, seconds, options.cpus,
+              ' pinned' if options.pinned else '', options.trace,
+              options.scale))
+    print_report(sim, tasks, seconds)
+
+    missed = [first for first in sim.first_miss if first is not None]
+    return 1 if missed else 0
+
+
+if __name__ == "__main__":
+    options = commandline_options()
+    try:
+        status = main(options)
+        sys.exit(status)
+    except Exception as error:
+        print(str(error))
+        if options.backtrace:
+            traceback.print_exc()
+        sys.exit(1)
@@ -0,0 +1,140 @@
+#!/usr/bin/env python3
+"""Explain the slowest jobs of each task with their performance counters.
+
+Copyright (c) 2018 Benjamin J. Andre
+
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v.  2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+Needs a trace recorded with laser-game -p. Each of the slowest jobs is
+compared against the median job of its task:
+
+  preemption  - the job was switched out more often than usual
+  faults      - the job took page faults
+  cache       - about the usual instruction count, many more LLC misses
+  algorithm   - the job executed many more instructions than usual
+
+"""
+
+from __future__ import print_function
+
+
+#
+# built-in modules
+#
+import argparse
+import sys
+import traceback
+
+#
+# other modules in this package
+#
+import plog_trace
+
+NSEC_PER_MSEC = float(plog_trace.NSEC_PER_MSEC)
+
+
+# -------------------------------------------------------------------------------
+#
+# User input
+#
+# -------------------------------------------------------------------------------
+def commandline_options():
+    """Process the command line arguments.
+
+    """
+    parser = argparse.ArgumentParser(
+        description='Attribute execution time spikes using perf counters.')
+
+    parser.add_argument('--backtrace', action='store_true',
+                        help='show exception backtraces as extra debugging '
+                        'output')
+
+    parser.add_argument('--top', type=int, default=5,
+                        help='number of slowest jobs to show per task')
+
+    parser.add_argument('trace', help='plog csv trace recorded with -p')
+
+    options = parser.parse_args()
+    return options
+
+
+# -------------------------------------------------------------------------------
+#
+# work functions
+#
+# -------------------------------------------------------------------------------
+def ratio(value, typical):
+    return float(value) / typical if typical else float(value)
+
+
+def classify(job, typical):
+    """Most likely cause of a slow job compared to the median job.
+
+    """
+    if job['ctx_switches'] > typical['ctx_switches']:
+        return 'preemption'
+    if job['page_faults'] > typical['page_faults']:
+        return 'faults'
+    instructions = ratio(job['instructions'], typical['instructions'])
+    misses = ratio(job['llc_misses'], typical['llc_misses'])
+    if instructions < 1.2 and misses > 2.0:
+        return 'cache'
+    if instructions >= 1.2:
+        return 'algorithm'
+    return 'unknown'
+
+
+def explain_task(task, records, top):
+    jobs = [(r.end - r.start, plog_trace.counters(r)) for r in records]
+    jobs = [job for job in jobs if job[1] is not None]
+    if not jobs:
+        print('{0}: no performance counters recorded'.format(
+            plog_trace.task_name(task)))
+        return
+
+    typical = dict((name, plog_trace.median([c[name] for _, c in jobs]))
+                   for name in plog_trace.COUNTER_NAMES)
+    typical_time = plog_trace.median([t for t, _ in jobs])
+
+    print('{0}: median {1:.3f} ms, {2} instructions, {3} llc misses'.format(
+        plog_trace.task_name(task), typical_time / NSEC_PER_MSEC,
+        typical['instructions'], typical['llc_misses']))
+    print('  {0:>9} {1:>7} {2:>7} {3:>7} {4:>5} {5:>6}  {6}'.format(
+        'time(ms)', 'instr', 'ipc', 'llc', 'csw', 'faults', 'cause'))
+
+    jobs.sort(key=lambda job: job[0], reverse=True)
+    for time, job in jobs[:top]:
+        ipc = ratio(job['instructions'], job['cycles'])
+        print('  {0:>9.3f} {1:>6.2f}x {2:>7.2f} {3:>6.2f}x {4:>5d} {5:>6d}  '
+              '{6}'.format(time / NSEC_PER_MSEC,
+                           ratio(job['instructions'], typical['instructions']),
+                           ipc,
+                           ratio(job['llc_misses'], typical['llc_misses']),
+                           job['ctx_switches'], job['page_faults'],
+                           classify(job, typical)))
+
+
+# -------------------------------------------------------------------------------
+#
+# main
+#
+# -------------------------------------------------------------------------------
+def main(options):
+    tasks = plog_trace.load_by_id(options.trace)
+    for task in sorted(tasks):
+        explain_task(task, tasks[task], options.top)
+    return 0
+
+
+if __name__ == "__main__":
+    options = commandline_options()
+    try:
+        status = main(options)
+        sys.exit(status)
+    except Exception as error:
+        print(str(error))
+        if options.backtrace:
+            traceback.print_exc()
+        sys.exit(1)
@@ -0,0 +1,214 @@
+
+/*
+** Copyright 2018 Benjamin J. Andre.
+** All Rights Reserved.
+**
+** This Source Code Form is subject to the terms of the Mozilla
+** Public License, v. 2.0. If a copy of the MPL was not distributed
+** with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/uio.h>
+
+#include "archive.hpp"
+
+using namespace cv;
+
+// fastest zlib level, the archive is written in the background but should
+// keep up with the camera
+static const int PNG_COMPRESSION = 1;
+
+static_assert((ARCHIVE_SLOTS & (ARCHIVE_SLOTS - 1)) == 0,
+              "ARCHIVE_SLOTS must be a power of two");
+
+bool archive_frame(archive_t *ar, archive_stream_t stream, const Mat &image,
+                   uint64_t frame, uint64_t time)
+{
+    archive_queue_t *q = &ar->queues[stream];
+    archive_slot_t *slot;
+    uint32_t head;
+
+    if (!ar->running) {
+        return true;
+    }
+
+    head = q->head;
+    slot = &q->slots[head & (ARCHIVE_SLOTS - 1)];
+
+    // a full queue, or a frame that would not fit the preallocated slot
+    if (head - __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE) >= ARCHIVE_SLOTS ||
+            image.rows != slot->image.rows || image.cols != slot->image.cols ||
+            image.type() != slot->image.type()) {
+        q->dropped++;
+        return false;
+    }
+
+    image.copyTo(slot->image);
+    slot->header.stream = (uint16_t)stream;
+    slot->header.frame = frame;
+    slot->header.time = time;
+
+    __atomic_store_n(&q->head, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+// fill in the record of a queued frame and point iov at it
+static void encode_slot(archive_t *ar, archive_slot_t *slot, struct iovec *iov)
+{
+    const Mat &image = slot->image;
+    std::vector<int> params;
+
+    slot->header.magic = ARCHIVE_MAGIC;
+    slot->header.format = (uint16_t)ar->format;
+    slot->header.width = (uint32_t)image.cols;
+    slot->header.height = (uint32_t)image.rows;
+    slot->header.type = (uint32_t)image.type();
+
+    iov[0].iov_base = &slot->header;
+    iov[0].iov_len = sizeof(slot->header);
+
+    if (ar->format == archive_png) {
+        params.push_back(CV_IMWRITE_PNG_COMPRESSION);
+        params.push_back(PNG_COMPRESSION);
+        imencode(".png", image, slot->encoded, params);
+        iov[1].iov_base = &slot->encoded[0];
+        iov[1].iov_len = slot->encoded.size();
+    } else {
+        // slots are allocated whole, so the rows are contiguous
+        iov[1].iov_base = image.data;
+        iov[1].iov_len = image.total() * image.elemSize();
+    }
+    slot->header.bytes = (uint32_t)iov[1].iov_len;
+}
+
+static int write_all(int fd, struct iovec *iov, int n)
+{
+    ssize_t done;
+
+    while (n > 0) {
+        done = writev(fd, iov, n);
+        if (done < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+
+        // skip what was written, a short write can end inside a record
+        while (n > 0 && (size_t)done >= iov->iov_len) {
+            done -= iov->iov_len;
+            iov++;
+            n--;
+        }
+        if (n > 0) {
+            iov->iov_base = (uint8_t *)iov->iov_base + done;
+            iov->iov_len -= done;
+        }
+    }
+    return 0;
+}
+
+// write out everything queued so far, ARCHIVE_BATCH records per writev
+static void drain(archive_t *ar)
+{
+    struct iovec iov[2 * ARCHIVE_BATCH];
+    uint32_t taken[archive_num_streams];
+    unsigned int s, n;
+    bool more = true, ok;
+
+    while (more) {
+        more = false;
+        n = 0;
+
+        for (s = 0; s < archive_num_streams; s++) {
+            archive_queue_t *q = &ar->queues[s];
+            uint32_t tail = q->tail;
+            uint32_t head = __atomic_load_n(&q->head, __ATOMIC_ACQUIRE);
+
+            taken[s] = 0;
+            while (tail + taken[s] != head && n < ARCHIVE_BATCH) {
+                archive_slot_t *slot =
+                    &q->slots[(tail + taken[s]) & (ARCHIVE_SLOTS - 1)];
+                encode_slot(ar, slot, &iov[2 * n]);
+                taken[s]++;
+                n++;
+            }
+            more = more || (tail + taken[s] != head);
+        }
+
+        ok = true;
+        if (n > 0 && write_all(ar->fd, iov, 2 * n) < 0) {
+            perror("archive writev");
+            ok = false;
+        }
+
+        // the slots go back to the services only once written, or once the
+        // write failed, so they are never stuck
+        for (s = 0; s < archive_num_streams; s++) {
+            archive_queue_t *q = &ar->queues[s];
+            if (ok) {
+                q->written += taken[s];
+            } else {
+                q->failed += taken[s];
+            }
+            __atomic_store_n(&q->tail, q->tail + taken[s], __ATOMIC_RELEASE);
+        }
+    }
+}
+
+void archive_flush(void *context)
+{
+    archive_t *ar = (archive_t *)context;
+
+    if (ar->running) {
+        drain(ar);
+    }
+}
+
+int archive_start(archive_t *ar, const char *filename, archive_format_t format,
+                  Size size)
+{
+    unsigned int s, i;
+
+    ar->running = false;
+    ar->format = format;
+
+    ar->fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (ar->fd < 0) {
+        return -1;
+    }
+
+    // every slot is touched now rather than in the services
+    for (s = 0; s < archive_num_streams; s++) {
+        archive_queue_t *q = &ar->queues[s];
+
+        q->head = 0;
+        q->tail = 0;
+        q->dropped = 0;
+        q->written = 0;
+        q->failed = 0;
+        for (i = 0; i < ARCHIVE_SLOTS; i++) {
+            q->slots[i].image = Mat::zeros(size, CV_8UC3);
+            memset(&q->slots[i].header, 0, sizeof(q->slots[i].header));
+        }
+    }
+
+    ar->running = true;
+    return 0;
+}
+
+void archive_stop(archive_t *ar)
+{
+    if (!ar->running) {
+        return;
+    }
+
+    drain(ar);
+    close(ar->fd);
+    ar->running = false;
+}
@@ -0,0 +1,124 @@
+/**
+   \file archive.hpp
+
+   Camera and rendered frames saved to disk by a best effort job, the
+   "save time-stamped image" and "save processed image" services.
+ */
+
+/*
+** Copyright 2018 Benjamin J. Andre.
+** All Rights Reserved.
+**
+** This Source Code Form is subject to the terms of the Mozilla
+** Public License, v. 2.0. If a copy of the MPL was not distributed
+** with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*/
+
+#ifndef RTES_ARCHIVE_H_
+#define RTES_ARCHIVE_H_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+static const uint32_t ARCHIVE_MAGIC = 0x4c474131u;     // "LGA1"
+
+/** frames each stream can have queued, a power of two */
+static const unsigned int ARCHIVE_SLOTS = 8u;
+/** records written by one writev */
+static const unsigned int ARCHIVE_BATCH = 8u;
+/** sequencer ticks between flushes of the queues */
+static const unsigned int ARCHIVE_FLUSH_PERIOD = 1u;
+
+typedef enum archive_stream_t_ {
+    archive_camera = 0,     /*!< frames as captured by Service_1 */
+    archive_rendered,       /*!< frames as drawn by Service_3 */
+    archive_num_streams,
+} archive_stream_t;
+
+typedef enum archive_format_t_ {
+    archive_raw = 0,        /*!< pixels as they are in memory */
+    archive_png,            /*!< PNG encoded by the writer thread */
+} archive_format_t;
+
+/**
+   Every frame in the file is this header followed by bytes of data, the
+   rows of the image without padding for raw records, a PNG file for PNG
+   records.
+ */
+typedef struct {
+    uint32_t magic;
+    uint16_t stream;        /*!< archive_stream_t */
+    uint16_t format;        /*!< archive_format_t */
+    uint64_t frame;         /*!< job count of the producing service */
+    uint64_t time;          /*!< CLOCK_MONOTONIC ns, capture or render */
+    uint32_t width;
+    uint32_t height;
+    uint32_t type;          /*!< OpenCV type of raw records */
+    uint32_t bytes;
+} archive_header_t;
+
+typedef struct {
+    cv::Mat image;
+    archive_header_t header;
+    std::vector<uint8_t> encoded;
+} archive_slot_t;
+
+/**
+   Single producer single consumer queue of one stream, like the event log
+   rings. The service owns head, archive_flush owns tail.
+ */
+typedef struct {
+    volatile uint32_t head __attribute__((aligned(64)));
+    volatile uint32_t tail __attribute__((aligned(64)));
+    unsigned long long dropped; /*!< frames the queue was full for */
+    unsigned long long written;
+    unsigned long long failed;  /*!< frames lost to a failed writev */
+    archive_slot_t slots[ARCHIVE_SLOTS];
+} archive_queue_t;
+
+/**
+   Archive of one pipeline. The services queue copies of their frames into
+   preallocated slots, which never blocks and never enters the kernel, and
+   drop the frame when their queue is full. archive_flush, a best effort
+   job, encodes the queued frames and appends them to the file with one
+   writev per batch.
+ */
+typedef struct {
+    bool running;
+    int fd;
+    archive_format_t format;
+    archive_queue_t queues[archive_num_streams];
+} archive_t;
+
+/**
+   Create the file and allocate every slot at size. Nothing is written
+   until archive_flush runs.
+
+   \return 0 on success, -1 with errno set
+ */
+int archive_start(archive_t *ar, const char *filename, archive_format_t format,
+                  cv::Size size);
+
+/**
+   Queue a copy of image, called by the service producing stream.
+
+   \return false if the queue was full and the frame was dropped
+ */
+bool archive_frame(archive_t *ar, archive_stream_t stream,
+                   const cv::Mat &image, uint64_t frame, uint64_t time);
+
+/**
+   Write out what is queued, an executor job. Must not run concurrently
+   with itself or archive_stop.
+ */
+void archive_flush(void *context);
+
+/**
+   Write out what is left and close the file, after the last flush job.
+ */
+void archive_stop(archive_t *ar);
+
+#endif /* RTES_ARCHIVE_H_ */
@@ -0,0 +1,348 @@
+
+/*
+** Copyright 2018 Benjamin J. Andre.
+** All Rights Reserved.
+**
+** This Source Code Form is subject to the terms of the Mozilla
+** Public License, v. 2.0. If a copy of the MPL was not distributed
+** with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*/
+
+// Runs the detection and tracking of Service_1 and Service_2 over every
+// recording in a directory as fast as the machine allows, for tuning the
+// detection thresholds on recorded sessions.
+//
+// There is no sequencer: each recording is read to its end by one worker
+// thread, every frame goes through sample_motion, detect_lasers and the
+// tracker as if Service_2 ran once per capture, and the workers take
+// recordings from a shared list until it is empty. Frames are stamped at
+// the Service_1 period so the trackers see the game's frame rate.
+//
+// Writes one csv row per frame with the position of each active track and
+// prints frames per second per recording and overall.
+
+#include <dirent.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <getopt.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/sysinfo.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "constants.hpp"
+#include "detect.hpp"
+#include "frame_source.hpp"
+#include "pipeline.hpp"
+#include "release_table.hpp"
+#include "tracker.hpp"
+
+using namespace cv;
+
+static const unsigned int MAX_WORKERS = 64u;
+
+// rows a worker collects before taking the output lock
+static const size_t FLUSH_BYTES = 64u * 1024u;
+
+typedef struct {
+    std::string path;
+    std::string name;
+    bool failed;
+    unsigned long long frames;
+    unsigned long long detected;    /*!< frames with at least one laser */
+    double seconds;
+} recording_t;
+
+typedef struct {
+    std::vector<recording_t> recordings;
+    unsigned int next;              /*!< next recording to take */
+    detect_params_t params;
+    FILE *out;
+    pthread_mutex_t outLock;
+} batch_t;
+
+static void usage(const char *name)
+{
+    printf("usage: %s [-j threads] [-m motion] [-r red] [-P pause] "
+           "[-o tracks.csv] directory\n", name);
+    printf("  -j  worker threads (default one per online core, max %u)\n",
+           MAX_WORKERS);
+    printf("  -m  motion threshold of the red channel (default %d)\n",
+           DEFAULT_MOTION_THRESHOLD);
+    printf("  -r  red threshold of a laser (default %d)\n",
+           DEFAULT_RED_THRESHOLD);
+    printf("  -P  mean motion, 0 to 255, above which play pauses "
+           "(default %.0f)\n", DEFAULT_PAUSE_MOTION);
+    printf("  -o  write the tracks to this file (default tracks.csv)\n");
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * NANOSEC_PER_SEC + ts.tv_nsec;
+}
+
+// regular files of dir in name order, hidden ones skipped
+static int list_recordings(const char *dir, std::vector<recording_t> &out)
+{
+    struct dirent *entry;
+    struct stat st;
+    DIR *d;
+
+    d = opendir(dir);
+    if (d == NULL) {
+        return -1;
+    }
+
+    while ((entry = readdir(d)) != NULL) {
+        recording_t rec;
+
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+        rec.name = entry->d_name;
+        rec.path = std::string(dir) + "/" + entry->d_name;
+        if (stat(rec.path.c_str(), &st) < 0 || !S_ISREG(st.st_mode)) {
+            continue;
+        }
+        rec.failed = false;
+        rec.frames = 0;
+        rec.detected = 0;
+        rec.seconds = 0.0;
+        out.push_back(rec);
+    }
+    closedir(d);
+
+    std::sort(out.begin(), out.end(),
+              [](const recording_t &a, const recording_t &b) {
+                  return a.name < b.name;
+              });
+    return 0;
+}
+
+static void flush_rows(batch_t *b, std::string &rows)
+{
+    pthread_mutex_lock(&b->outLock);
+    fwrite(rows.data(), 1, rows.size(), b->out);
+    pthread_mutex_unlock(&b->outLock);
+    rows.clear();
+}
+
+static void track_recording(batch_t *b, recording_t *rec)
+{
+    frame_source_config_t config;
+    FrameSource source;
+    Mat frame, sized, bgr[3], red, acc, accScaled, motion;
+    tracking_scratch_t scratch;
+    Tracker tracker(NUM_PLAYERS, TRACKING_GATE, TRACKING_MAX_MISSES);
+    std::string rows;
+    char line[64];
+    uint64_t start, time;
+    unsigned int p;
+    bool paused;
+
+    config.kind = mjpeg_file(rec->path.c_str()) ? source_mjpeg : source_replay;
+    config.index = -1;
+    config.file = rec->path.c_str();
+    config.once = true;
+    config.size = Size(VIDEO_WIDTH, VIDEO_HEIGHT);
+
+    if (source.open(config) < 0) {
+        rec->failed = true;
+        return;
+    }
+
+    acc = Mat::zeros(config.size, CV_32FC1);
+    start = now_ns();
+
+    while (source.read(frame) && !frame.empty()) {
+        const Mat *f = &frame;
+        size_t detections = 0;
+
+        // recordings through VideoCapture come at their own size
+        if (frame.size() != config.size) {
+            resize(frame, sized, config.size, 0, 0, INTER_AREA);
+            f = &sized;
+        }
+
+        time = rec->frames * period_ns(0);
+        paused = sample_motion(*f, b->params, bgr, red, acc, accScaled,
+                               motion);
+        if (!paused) {
+            detect_lasers(red, motion, quality_full, Rect(), b->params,
+                          scratch);
+            locate_lasers(scratch);
+            tracker.update(scratch.center, time);
+            detections = scratch.center.size();
+        }
+
+        rows += rec->name;
+        snprintf(line, sizeof(line), ",%llu,%.1f,%d,%zu", rec->frames,
+                 (double)time / 1e6, paused ? 1 : 0, detections);
+        rows += line;
+        for (p = 0; p < NUM_PLAYERS; p++) {
+            const track_t &track = tracker.track(p);
+
+            if (track.active) {
+                snprintf(line, sizeof(line), ",%.1f,%.1f", track.pos.x,
+                         track.pos.y);
+                rows += line;
+            } else {
+                rows += ",,";
+            }
+        }
+        rows += "\n";
+
+        if (rows.size() >= FLUSH_BYTES) {
+            flush_rows(b, rows);
+        }
+
+        rec->frames++;
+        if (detections > 0) {
+            rec->detected++;
+        }
+    }
+
+    rec->seconds = (double)(now_ns() - start) / 1e9;
+    flush_rows(b, rows);
+}
+
+static void *worker_thread(void *context)
+{
+    batch_t *b = (batch_t *)context;
+    unsigned int i;
+
+    // longest first would balance better, but the length of a recording
+    // is not known before decoding it
+    while ((i = __atomic_fetch_add(&b->next, 1, __ATOMIC_RELAXED)) <
+            b->recordings.size()) {
+        track_recording(b, &b->recordings[i]);
+    }
+
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    static batch_t batch;
+    pthread_t workers[MAX_WORKERS];
+    const char *outFile = "tracks.csv";
+    unsigned int numWorkers = std::min((unsigned int)get_nprocs(),
+                                       MAX_WORKERS);
+    unsigned long long frames = 0;
+    uint64_t start;
+    double seconds;
+    unsigned int i, p, started = 0;
+    int opt;
+
+    detect_params_default(&batch.params);
+
+    while ((opt = getopt(argc, argv, "j:m:r:P:o:h")) != -1) {
+        switch (opt) {
+        case 'j':
+            numWorkers = (unsigned int)strtoul(optarg, NULL, 10);
+            break;
+        case 'm':
+            batch.params.motionThreshold = atoi(optarg);
+            break;
+        case 'r':
+            batch.params.redThreshold = atoi(optarg);
+            break;
+        case 'P':
+            batch.params.pauseMotion = atof(optarg);
+            break;
+        case 'o':
+            outFile = optarg;
+            break;
+        case 'h':
+            usage(argv[0]);
+            exit(0);
+        default:
+            usage(argv[0]);
+            exit(-1);
+        }
+    }
+    if (optind >= argc || numWorkers < 1 || numWorkers > MAX_WORKERS ||
+            batch.params.redThreshold < 0 || batch.params.redThreshold > 255) {
+        usage(argv[0]);
+        exit(-1);
+    }
+
+    if (list_recordings(argv[optind], batch.recordings) < 0) {
+        perror(argv[optind]);
+        exit(-1);
+    }
+    if (batch.recordings.empty()) {
+        fprintf(stderr, "no recordings in %s\n", argv[optind]);
+        exit(-1);
+    }
+
+    batch.out = fopen(outFile, "w");
+    if (batch.out == NULL) {
+        perror(outFile);
+        exit(-1);
+    }
+    fprintf(batch.out, "file,frame,time_ms,paused,detections");
+    for (p = 0; p < NUM_PLAYERS; p++) {
+        fprintf(batch.out, ",x%u,y%u", p, p);
+    }
+    fprintf(batch.out, "\n");
+
+    // the recordings are the parallelism, OpenCV's own thread pool would
+    // only oversubscribe the cores
+    setNumThreads(1);
+
+    pthread_mutex_init(&batch.outLock, NULL);
+    batch.next = 0;
+    numWorkers = std::min(numWorkers, (unsigned int)batch.recordings.size());
+
+    start = now_ns();
+    for (i = 0; i < numWorkers; i++) {
+        if (pthread_create(&workers[i], NULL, worker_thread, &batch) != 0) {
+            perror("pthread_create");
+            break;
+        }
+        started++;
+    }
+    if (started == 0) {
+        exit(-1);
+    }
+    for (i = 0; i < started; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    seconds = (double)(now_ns() - start) / 1e9;
+
+    fclose(batch.out);
+    pthread_mutex_destroy(&batch.outLock);
+
+    for (i = 0; i < batch.recordings.size(); i++) {
+        const recording_t *rec = &batch.recordings[i];
+
+        if (rec->failed) {
+            printf("%s: could not be opened\n", rec->name.c_str());
+            continue;
+        }
+        printf("%s: %llu frames, %.1f fps, lasers in %llu\n",
+               rec->name.c_str(), rec->frames,
+               (rec->seconds > 0.0) ? rec->frames / rec->seconds : 0.0,
+               rec->detected);
+        frames += rec->frames;
+    }
+    printf("%llu frames of %zu recordings in %.2f s on %u threads, "
+           "%.1f fps\n", frames, batch.recordings.size(), seconds, started,
+           (seconds > 0.0) ? frames / seconds : 0.0);
+
+    return 0;
+}
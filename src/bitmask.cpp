@@ -0,0 +1,283 @@
+
+/*
+** Copyright 2018 Benjamin J. Andre.
+** All Rights Reserved.
+**
+** This Source Code Form is subject to the terms of the Mozilla
+** Public License, v. 2.0. If a copy of the MPL was not distributed
+** with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*/
+
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "bitmask.hpp"
+
+using namespace cv;
+
+static const int WORD_BITS = 64;
+
+// bit sliced counts of a horizontal window, per mask word
+static const int COUNT_SLICES = 3;
+
+// a 5x5 window of a binary image has at least this many pixels set
+// for its median to be set
+static const int MEDIAN5_MAJORITY = 13;
+static_assert(MEDIAN5_MAJORITY == 13, "the median5 majority test is for 13");
+
+// multiplying 8 bytes that are each 0 or 1 by this gathers them, byte i
+// into bit 56 + i
+static const uint64_t GATHER_BYTES = 0x0102040810204080ull;
+
+// bytes of the 8 pixels of each bit pattern, 0 or 255
+typedef struct {
+    uint64_t bytes[256];
+} spread_table_t;
+
+constexpr spread_table_t make_spread_table()
+{
+    spread_table_t table = {};
+    unsigned int pattern = 0, i = 0;
+
+    for (pattern = 0; pattern < 256; pattern++) {
+        for (i = 0; i < 8; i++) {
+            if (pattern & (1u << i)) {
+                table.bytes[pattern] |= 0xffull << (8 * i);
+            }
+        }
+    }
+    return table;
+}
+
+static constexpr spread_table_t SPREAD = make_spread_table();
+
+void bitmask_resize(bitmask_t *mask, int width, int height)
+{
+    mask->width = width;
+    mask->height = height;
+    mask->words = (width + WORD_BITS - 1) / WORD_BITS;
+    mask->bits.resize((size_t)mask->words * height);
+}
+
+// make the bits past the width repeat the last pixel of the row
+static void fill_padding(uint64_t *row, int width, int words)
+{
+    int used = width - (words - 1) * WORD_BITS;
+    uint64_t pad;
+
+    if (used == WORD_BITS) {
+        return;
+    }
+
+    pad = ~0ull << used;
+    if ((row[words - 1] >> (used - 1)) & 1u) {
+        row[words - 1] |= pad;
+    } else {
+        row[words - 1] &= ~pad;
+    }
+}
+
+// 64 pixels of a full resolution row, the comparisons vectorize and are
+// then gathered 8 at a time
+static uint64_t pack_word(const uint8_t *p, uint8_t thresh)
+{
+    uint8_t set[WORD_BITS];
+    uint64_t word = 0, v;
+    int b;
+
+    for (b = 0; b < WORD_BITS; b++) {
+        set[b] = p[b] > thresh;
+    }
+    for (b = 0; b < WORD_BITS; b += 8) {
+        memcpy(&v, &set[b], sizeof(v));
+        word |= ((v * GATHER_BYTES) >> 56) << b;
+    }
+    return word;
+}
+
+void bitmask_threshold(const Mat &gray, uint8_t thresh, int step,
+                       bitmask_t *out)
+{
+    int x, y, j, b, n;
+
+    bitmask_resize(out, (gray.cols + step - 1) / step,
+                   (gray.rows + step - 1) / step);
+
+    for (y = 0; y < out->height; y++) {
+        const uint8_t *p = gray.ptr<uint8_t>(y * step);
+        uint64_t *row = &out->bits[(size_t)y * out->words];
+
+        for (j = 0; j < out->words; j++) {
+            uint64_t word = 0;
+
+            x = j * WORD_BITS;
+            n = std::min(WORD_BITS, out->width - x);
+            if (step == 1 && n == WORD_BITS) {
+                row[j] = pack_word(p + x, thresh);
+                continue;
+            }
+            for (b = 0; b < n; b++) {
+                word |= (uint64_t)(p[(x + b) * step] > thresh) << b;
+            }
+            row[j] = word;
+        }
+        fill_padding(row, out->width, out->words);
+    }
+}
+
+void bitmask_and(const bitmask_t *a, const bitmask_t *b, bitmask_t *out)
+{
+    size_t i, n;
+
+    bitmask_resize(out, a->width, a->height);
+    n = out->bits.size();
+
+    // padding of both inputs repeats their last pixels, so does the result
+    for (i = 0; i < n; i++) {
+        out->bits[i] = a->bits[i] & b->bits[i];
+    }
+}
+
+static inline uint64_t majority(uint64_t x, uint64_t y, uint64_t z)
+{
+    return (x & y) | (z & (x ^ y));
+}
+
+// 3 bit count of the five pixels x-2..x+2 for the 64 pixels of word w,
+// prev and next are the words on either side
+static inline void count_window(uint64_t prev, uint64_t w, uint64_t next,
+                                uint64_t count[COUNT_SLICES])
+{
+    uint64_t a = (w << 2) | (prev >> 62);
+    uint64_t b = (w << 1) | (prev >> 63);
+    uint64_t d = (w >> 1) | (next << 63);
+    uint64_t e = (w >> 2) | (next << 62);
+
+    // two full adders, a + b + w + d + e = s + 2 * (k1 + k2)
+    uint64_t s1 = a ^ b ^ w;
+    uint64_t k1 = majority(a, b, w);
+    uint64_t s = s1 ^ d ^ e;
+    uint64_t k2 = majority(s1, d, e);
+
+    count[0] = s;
+    count[1] = k1 ^ k2;
+    count[2] = k1 & k2;
+}
+
+// sum = a + b of n bit sliced numbers, sum has n + 1 slices
+static inline void add_slices(const uint64_t *a, const uint64_t *b,
+                              uint64_t *sum, int n)
+{
+    uint64_t carry = 0;
+    int i;
+
+    for (i = 0; i < n; i++) {
+        sum[i] = a[i] ^ b[i] ^ carry;
+        carry = majority(a[i], b[i], carry);
+    }
+    sum[n] = carry;
+}
+
+void bitmask_median5(const bitmask_t *in, bitmask_t *out,
+                     std::vector<uint64_t> &scratch)
+{
+    int y, j, k;
+    size_t stride = (size_t)in->words * COUNT_SLICES;
+
+    bitmask_resize(out, in->width, in->height);
+    if (in->words == 0 || in->height == 0) {
+        return;
+    }
+    scratch.resize(stride * in->height);
+
+    // horizontal counts once per row, each is used by five output rows
+    for (y = 0; y < in->height; y++) {
+        const uint64_t *row = &in->bits[(size_t)y * in->words];
+        uint64_t *count = &scratch[y * stride];
+        // outside the row the border pixels repeat
+        uint64_t prev = (row[0] & 1u) ? ~0ull : 0;
+        uint64_t last = (row[in->words - 1] >> (WORD_BITS - 1)) ? ~0ull : 0;
+
+        for (j = 0; j < in->words; j++) {
+            uint64_t next = (j + 1 < in->words) ? row[j + 1] : last;
+
+            count_window(prev, row[j], next, &count[j * COUNT_SLICES]);
+            prev = row[j];
+        }
+    }
+
+    for (y = 0; y < in->height; y++) {
+        const uint64_t *counts[5];
+        uint64_t *row = &out->bits[(size_t)y * out->words];
+
+        for (k = 0; k < 5; k++) {
+            int r = std::min(std::max(y + k - 2, 0), in->height - 1);
+            counts[k] = &scratch[r * stride];
+        }
+
+        for (j = 0; j < in->words; j++) {
+            const uint64_t *c4 = counts[4] + j * COUNT_SLICES;
+            uint64_t a[4], b[4], ab[5], sum[6];
+
+            // a tree rather than a chain so the adders overlap
+            add_slices(counts[0] + j * COUNT_SLICES,
+                       counts[1] + j * COUNT_SLICES, a, 3);
+            add_slices(counts[2] + j * COUNT_SLICES,
+                       counts[3] + j * COUNT_SLICES, b, 3);
+            add_slices(a, b, ab, 4);
+            uint64_t c[5] = {c4[0], c4[1], c4[2], 0, 0};
+            add_slices(ab, c, sum, 5);
+
+            // sum <= 25, sum >= 13 = 0b01101
+            row[j] = sum[4] | (sum[3] & sum[2] & (sum[1] | sum[0]));
+        }
+        fill_padding(row, out->width, out->words);
+    }
+}
+
+uint64_t bitmask_count(const bitmask_t *mask)
+{
+    uint64_t total = 0, last;
+    int y, j, used;
+
+    if (mask->words == 0) {
+        return 0;
+    }
+
+    used = mask->width - (mask->words - 1) * WORD_BITS;
+    last = (used == WORD_BITS) ? ~0ull : ~(~0ull << used);
+
+    for (y = 0; y < mask->height; y++) {
+        const uint64_t *row = &mask->bits[(size_t)y * mask->words];
+        for (j = 0; j < mask->words - 1; j++) {
+            total += __builtin_popcountll(row[j]);
+        }
+        total += __builtin_popcountll(row[mask->words - 1] & last);
+    }
+    return total;
+}
+
+void bitmask_unpack(const bitmask_t *mask, Mat &out)
+{
+    int x, y;
+    int whole = mask->width & ~7;
+
+    out.create(mask->height, mask->width, CV_8UC1);
+
+    // 8 pixels per table lookup, then the tail of the row
+    for (y = 0; y < mask->height; y++) {
+        const uint64_t *row = &mask->bits[(size_t)y * mask->words];
+        uint8_t *p = out.ptr<uint8_t>(y);
+
+        for (x = 0; x < whole; x += 8) {
+            uint64_t pattern = (row[x / WORD_BITS] >> (x % WORD_BITS)) & 0xff;
+            memcpy(&p[x], &SPREAD.bytes[pattern], 8);
+        }
+        for (; x < mask->width; x++) {
+            p[x] = (uint8_t)(0 - ((row[x / WORD_BITS] >> (x % WORD_BITS)) &
+                                  1u));
+        }
+    }
+}
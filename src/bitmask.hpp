@@ -0,0 +1,76 @@
+/**
+   \file bitmask.hpp
+
+   Binary masks packed 64 pixels to a word.
+ */
+
+/*
+** Copyright 2018 Benjamin J. Andre.
+** All Rights Reserved.
+**
+** This Source Code Form is subject to the terms of the Mozilla
+** Public License, v. 2.0. If a copy of the MPL was not distributed
+** with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*/
+
+#ifndef RTES_BITMASK_H_
+#define RTES_BITMASK_H_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+/**
+   Pixel x of row y is bit x % 64 of word y * words + x / 64. The unused
+   bits past the width of each row repeat the row's last pixel, so the
+   filters see a replicated border without special cases.
+ */
+typedef struct {
+    int width;
+    int height;
+    int words;                    /*!< words per row */
+    std::vector<uint64_t> bits;   /*!< storage, only grows */
+} bitmask_t;
+
+/**
+   Size a mask, reallocating only when it grows.
+ */
+void bitmask_resize(bitmask_t *mask, int width, int height);
+
+/**
+   Set the pixels of an 8 bit image brighter than thresh, like
+   THRESH_BINARY. With step 2 every other pixel of every other row is
+   taken, a nearest neighbour half resolution mask.
+ */
+void bitmask_threshold(const cv::Mat &gray, uint8_t thresh, int step,
+                       bitmask_t *out);
+
+/**
+   out = a & b, a word at a time. a and b must be the same size.
+ */
+void bitmask_and(const bitmask_t *a, const bitmask_t *b, bitmask_t *out);
+
+/**
+   5x5 median of a binary image, i.e. a pixel is set when at least 13 of
+   the 25 pixels around it are, with a replicated border like medianBlur.
+   Counts are kept bit sliced, 64 pixels per word operation: a 3 bit count
+   of each row's horizontal window, then five of those summed vertically.
+
+   \param scratch reused across calls, grows to 3 words per mask word
+ */
+void bitmask_median5(const bitmask_t *in, bitmask_t *out,
+                     std::vector<uint64_t> &scratch);
+
+/**
+   Number of set pixels.
+ */
+uint64_t bitmask_count(const bitmask_t *mask);
+
+/**
+   Expand to a 0/255 8 bit image, e.g. for findContours.
+ */
+void bitmask_unpack(const bitmask_t *mask, cv::Mat &out);
+
+#endif /* RTES_BITMASK_H_ */
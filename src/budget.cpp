@@ -0,0 +1,177 @@
+
+/*
+** Copyright 2018 Benjamin J. Andre.
+** All Rights Reserved.
+**
+** This Source Code Form is subject to the terms of the Mozilla
+** Public License, v. 2.0. If a copy of the MPL was not distributed
+** with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*/
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/syscall.h>
+
+#include "budget.hpp"
+#include "constants.hpp"
+
+// older glibc only has the union member
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+
+// largest CPU time the trace can hold, in us
+static const uint64_t MAX_TRACED_USEC = 0xffffffu;
+
+static pthread_once_t handlerOnce = PTHREAD_ONCE_INIT;
+
+static int budget_signal(void)
+{
+    return SIGRTMIN + 1;
+}
+
+static uint64_t timespec_ns(const struct timespec *t)
+{
+    return (uint64_t)t->tv_sec * NANOSEC_PER_SEC + (uint64_t)t->tv_nsec;
+}
+
+// runs on the overrunning thread, so the policy change applies to it
+static void on_exhausted(int sig, siginfo_t *info, void *context)
+{
+    budget_t *b = (budget_t *)info->si_value.sival_ptr;
+    struct sched_param param;
+
+    (void)sig;
+    (void)context;
+
+    b->exhausted = 1;
+    if (b->policy == SCHED_FIFO || b->policy == SCHED_RR) {
+        param.sched_priority = 0;
+        sched_setscheduler(0, SCHED_OTHER, &param);
+    }
+}
+
+static void install_handler(void)
+{
+    struct sigaction action;
+
+    memset(&action, 0, sizeof(action));
+    action.sa_sigaction = on_exhausted;
+    action.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(budget_signal(), &action, NULL);
+}
+
+void budget_init(budget_t *b, uint64_t budget, plog_buffer_t *trace,
+                 uint32_t service)
+{
+    memset(b, 0, sizeof(*b));
+    b->budget = budget;
+    b->trace = trace;
+    b->service = service;
+}
+
+int budget_start(budget_t *b)
+{
+    struct sigevent sev;
+    struct sched_param param;
+
+    if (b->budget == 0) {
+        return 0;
+    }
+
+    pthread_once(&handlerOnce, install_handler);
+
+    b->policy = sched_getscheduler(0);
+    sched_getparam(0, &param);
+    b->priority = param.sched_priority;
+
+    memset(&sev, 0, sizeof(sev));
+    sev.sigev_notify = SIGEV_THREAD_ID;
+    sev.sigev_signo = budget_signal();
+    sev.sigev_value.sival_ptr = b;
+    sev.sigev_notify_thread_id = (pid_t)syscall(SYS_gettid);
+
+    if (timer_create(CLOCK_THREAD_CPUTIME_ID, &sev, &b->timer) < 0) {
+        return -1;
+    }
+    b->running = true;
+    return 0;
+}
+
+void budget_arm(budget_t *b)
+{
+    struct itimerspec spec;
+
+    if (!b->running) {
+        return;
+    }
+
+    b->exhausted = 0;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &b->jobStart);
+
+    // relative to the thread's CPU time, time spent blocked does not count
+    memset(&spec, 0, sizeof(spec));
+    spec.it_value.tv_sec = b->budget / NANOSEC_PER_SEC;
+    spec.it_value.tv_nsec = b->budget % NANOSEC_PER_SEC;
+    timer_settime(b->timer, 0, &spec, NULL);
+}
+
+bool budget_exhausted(const budget_t *b)
+{
+    return b->exhausted != 0;
+}
+
+bool budget_complete(budget_t *b)
+{
+    struct itimerspec spec;
+    struct timespec now;
+    struct sched_param param;
+    uint64_t usec;
+
+    if (!b->running) {
+        return false;
+    }
+
+    memset(&spec, 0, sizeof(spec));
+    timer_settime(b->timer, 0, &spec, NULL);
+
+    if (!b->exhausted) {
+        return false;
+    }
+
+    if (b->policy == SCHED_FIFO || b->policy == SCHED_RR) {
+        param.sched_priority = b->priority;
+        sched_setscheduler(0, b->policy, &param);
+    }
+
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    usec = (timespec_ns(&now) - timespec_ns(&b->jobStart)) / 1000u;
+    if (usec > MAX_TRACED_USEC) {
+        usec = MAX_TRACED_USEC;
+    }
+    eventPlog(b->trace, PLOG_ID_BUDGET, b->service | ((uint32_t)usec << 8));
+
+    b->exhausted = 0;
+    b->violations++;
+    return true;
+}
+
+void budget_stop(budget_t *b)
+{
+    if (b->running) {
+        timer_delete(b->timer);
+        b->running = false;
+    }
+}
+
+unsigned long long budget_violations(const budget_t *b)
+{
+    return b->violations;
+}
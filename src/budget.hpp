@@ -0,0 +1,103 @@
+/**
+   \file budget.hpp
+
+   Per job CPU time budgets of the service threads, enforced with thread
+   CPU time timers.
+ */
+
+/*
+** Copyright 2018 Benjamin J. Andre.
+** All Rights Reserved.
+**
+** This Source Code Form is subject to the terms of the Mozilla
+** Public License, v. 2.0. If a copy of the MPL was not distributed
+** with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*/
+
+#ifndef RTES_BUDGET_H_
+#define RTES_BUDGET_H_
+
+#include <stdint.h>
+
+#include <signal.h>
+#include <time.h>
+
+#include "plog.hpp"
+
+/**
+   plog id of budget overruns, one event per overrunning job. The arg
+   column holds service | (cpu << 8), the CPU time the job used in us,
+   saturated at 24 bits.
+ */
+static const uint32_t PLOG_ID_BUDGET = 18u;
+
+/**
+   Budget of one service thread. A timer on the thread's own CPU time clock
+   is armed at the start of every job. If the job uses up its budget the
+   timer's signal demotes the thread from SCHED_FIFO to SCHED_OTHER, so a
+   runaway job can no longer starve lower priority services, and the job
+   completes in the background. The priority is restored when the job
+   ends. Threads under SCHED_DEADLINE are throttled by the kernel and only
+   have their overruns counted.
+ */
+typedef struct {
+    bool running;           /*!< timer created by budget_start */
+    timer_t timer;
+    uint64_t budget;        /*!< CPU time per job, ns */
+    uint32_t service;       /*!< reported in the trace */
+    plog_buffer_t *trace;
+    int policy;             /*!< scheduling of the thread outside overruns */
+    int priority;
+    struct timespec jobStart;           /*!< thread CPU time at arm */
+    volatile sig_atomic_t exhausted;    /*!< set by the timer's signal */
+    volatile unsigned long long violations;
+} budget_t;
+
+/**
+   Set up a budget, before the service thread starts.
+
+   \param[in] budget CPU time per job in ns, 0 disables enforcement
+   \param[in] trace plog buffer overruns are written to
+   \param[in] service number of the service in the trace
+ */
+void budget_init(budget_t *b, uint64_t budget, plog_buffer_t *trace,
+                 uint32_t service);
+
+/**
+   Create the timer on the calling thread's CPU time clock. Called by the
+   service itself once it has its final scheduling policy.
+
+   \return 0 on success, -1 with errno set
+ */
+int budget_start(budget_t *b);
+
+/**
+   Arm the budget at the start of a job.
+ */
+void budget_arm(budget_t *b);
+
+/**
+   true once the current job has used up its budget. Jobs check this at
+   safe points to abandon the rest of their work.
+ */
+bool budget_exhausted(const budget_t *b);
+
+/**
+   Disarm at the end of a job, restore the thread's priority and trace the
+   overrun if there was one.
+
+   \return true if the job overran its budget
+ */
+bool budget_complete(budget_t *b);
+
+/**
+   Delete the timer, called by the service thread when it exits.
+ */
+void budget_stop(budget_t *b);
+
+/**
+   Jobs that overran so far, read by the sequencer.
+ */
+unsigned long long budget_violations(const budget_t *b);
+
+#endif /* RTES_BUDGET_H_ */
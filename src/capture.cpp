@@ -0,0 +1,200 @@
+
+/*
+** Copyright 2018 Benjamin J. Andre.
+** All Rights Reserved.
+**
+** This Source Code Form is subject to the terms of the Mozilla
+** Public License, v. 2.0. If a copy of the MPL was not distributed
+** with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*/
+
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+
+#include "capture.hpp"
+#include "constants.hpp"
+#include "telemetry.hpp"
+
+using namespace cv;
+
+// set in latest while its slot has not been taken
+static const uint32_t CAPTURE_FRESH = 0x80000000u;
+
+// how often capture_wait looks for a fresh frame
+static const long CAPTURE_POLL_NSEC = 1000000L;
+
+static void timespec_add_ns(struct timespec *ts, uint64_t ns)
+{
+    ts->tv_nsec += ns;
+    while (ts->tv_nsec >= (long)NANOSEC_PER_SEC) {
+        ts->tv_nsec -= NANOSEC_PER_SEC;
+        ts->tv_sec++;
+    }
+}
+
+static void *capture_thread(void *context)
+{
+    capture_t *c = (capture_t *)context;
+    bool paced = (c->config.kind != source_camera);
+    bool wait = paced;
+    struct timespec next;
+    capture_slot_t *slot;
+    uint32_t old;
+
+    clock_gettime(CLOCK_MONOTONIC, &next);
+
+    while (!c->stop) {
+        if (wait) {
+            timespec_add_ns(&next, SEQUENCER_PERIOD_NSEC);
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next,
+                                   NULL) == EINTR) {
+            }
+        }
+
+        slot = &c->slots[c->back];
+        if (!c->source.read(slot->frame)) {
+            c->ended = true;
+            break;
+        }
+        // a camera that fails does so at once, retry a tick later
+        if (slot->frame.empty()) {
+            c->failed++;
+            clock_gettime(CLOCK_MONOTONIC, &next);
+            wait = true;
+            continue;
+        }
+        wait = paced;
+        slot->time = telemetry_now();
+        c->captured++;
+
+        // publish the frame and take back the slot it replaces
+        old = __atomic_exchange_n(&c->latest, c->back | CAPTURE_FRESH,
+                                  __ATOMIC_ACQ_REL);
+        c->back = old & ~CAPTURE_FRESH;
+        if (old & CAPTURE_FRESH) {
+            c->dropped++;
+        }
+    }
+
+    return NULL;
+}
+
+int capture_start(capture_t *c, const frame_source_config_t &config,
+                  int priority, const cpu_set_t *cpus)
+{
+    pthread_attr_t attr;
+    struct sched_param param;
+    unsigned int i;
+    int rc;
+
+    c->config = config;
+    c->running = false;
+    c->stop = false;
+    c->ended = false;
+    c->latest = 0;
+    c->captured = 0;
+    c->failed = 0;
+    c->dropped = 0;
+    c->taken = 0;
+    c->stale = 0;
+
+    if (c->source.open(config) < 0) {
+        errno = ENODEV;
+        return -1;
+    }
+
+    // every slot gets the size and type of the first frame, so reading
+    // into them never allocates
+    if (!c->source.read(c->slots[0].frame) || c->slots[0].frame.empty()) {
+        errno = ENODATA;
+        return -1;
+    }
+    c->slots[0].time = telemetry_now();
+    for (i = 1; i < CAPTURE_SLOTS; i++) {
+        c->slots[0].frame.copyTo(c->slots[i].frame);
+    }
+    c->captured = 1;
+    c->latest = 0 | CAPTURE_FRESH;
+    c->back = 1;
+    c->front = 2;
+
+    memset(&param, 0, sizeof(param));
+    param.sched_priority = priority;
+
+    pthread_attr_init(&attr);
+    pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+    pthread_attr_setschedpolicy(&attr, (priority > 0) ? SCHED_FIFO :
+                                SCHED_OTHER);
+    pthread_attr_setschedparam(&attr, &param);
+    if (cpus != NULL) {
+        pthread_attr_setaffinity_np(&attr, sizeof(*cpus), cpus);
+    }
+    rc = pthread_create(&c->thread, &attr, capture_thread, c);
+    pthread_attr_destroy(&attr);
+
+    if (rc != 0) {
+        errno = rc;
+        return -1;
+    }
+
+    c->running = true;
+    return 0;
+}
+
+// swap the slot Service_1 owns for the newest one if that is fresh
+static bool take(capture_t *c, Mat &frame, uint64_t *time)
+{
+    const capture_slot_t *slot;
+    uint32_t old;
+
+    if (!(__atomic_load_n(&c->latest, __ATOMIC_ACQUIRE) & CAPTURE_FRESH)) {
+        return false;
+    }
+
+    // only the capture thread changes latest meanwhile, and only to a
+    // fresh slot
+    old = __atomic_exchange_n(&c->latest, c->front, __ATOMIC_ACQ_REL);
+    c->front = old & ~CAPTURE_FRESH;
+    slot = &c->slots[c->front];
+
+    // copied rather than handed over, Service_3 renders the frame of the
+    // previous job while the capture thread reads into its slot
+    slot->frame.copyTo(frame);
+    *time = slot->time;
+    c->taken++;
+    return true;
+}
+
+bool capture_take(capture_t *c, Mat &frame, uint64_t *time)
+{
+    if (!take(c, frame, time)) {
+        c->stale++;
+        return false;
+    }
+    return true;
+}
+
+bool capture_wait(capture_t *c, Mat &frame, uint64_t *time)
+{
+    struct timespec poll = {0, CAPTURE_POLL_NSEC};
+
+    while (!take(c, frame, time)) {
+        if (!c->running || c->ended) {
+            return false;
+        }
+        nanosleep(&poll, NULL);
+    }
+    return true;
+}
+
+void capture_stop(capture_t *c)
+{
+    if (!c->running) {
+        return;
+    }
+
+    c->stop = true;
+    pthread_join(c->thread, NULL);
+    c->running = false;
+}
@@ -0,0 +1,98 @@
+/**
+   \file capture.hpp
+
+   Frames read from a pipeline's source by a thread of their own, so that
+   waiting on the camera is no longer part of Service_1.
+ */
+
+/*
+** Copyright 2018 Benjamin J. Andre.
+** All Rights Reserved.
+**
+** This Source Code Form is subject to the terms of the Mozilla
+** Public License, v. 2.0. If a copy of the MPL was not distributed
+** with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*/
+
+#ifndef RTES_CAPTURE_H_
+#define RTES_CAPTURE_H_
+
+#include <stdint.h>
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <opencv2/opencv.hpp>
+
+#include "frame_source.hpp"
+
+/** the frame being read, the newest one and the one being processed */
+static const unsigned int CAPTURE_SLOTS = 3u;
+
+typedef struct {
+    cv::Mat frame;
+    uint64_t time;              /*!< CLOCK_MONOTONIC ns the read returned */
+} capture_slot_t;
+
+/**
+   Latest frame wins triple buffer between the capture thread and
+   Service_1. The thread reads into the slot it owns and swaps it with the
+   newest one; Service_1 swaps the slot it owns with the newest one when
+   that is fresh. Neither side ever waits for the other, a frame that is
+   replaced before Service_1 takes it is dropped, and a job that finds no
+   fresh frame keeps the one it has and counts as stale.
+
+   Cameras pace the thread by blocking in the driver. Recordings and
+   synthetic frames are read once per sequencer tick, the camera rate.
+ */
+typedef struct {
+    FrameSource source;
+    frame_source_config_t config;
+    pthread_t thread;
+    volatile bool running;
+    volatile bool stop;
+    volatile bool ended;        /*!< a recording played once has ended */
+
+    capture_slot_t slots[CAPTURE_SLOTS];
+    uint32_t latest;            /*!< newest slot, top bit set until taken */
+    uint32_t back;              /*!< owned by the capture thread */
+    uint32_t front;             /*!< owned by Service_1 */
+
+    unsigned long long captured;    /*!< frames read */
+    unsigned long long failed;      /*!< reads that returned no frame */
+    unsigned long long dropped;     /*!< frames replaced before being taken */
+    unsigned long long taken;       /*!< fresh frames taken */
+    unsigned long long stale;       /*!< takes that found no fresh frame */
+} capture_t;
+
+/**
+   Open the source, read a first frame synchronously to size every slot
+   and start the capture thread at SCHED_FIFO priority, or SCHED_OTHER for
+   0, on cpus unless NULL. The first frame is ready to be taken.
+
+   \return 0 on success, -1 with errno set
+ */
+int capture_start(capture_t *c, const frame_source_config_t &config,
+                  int priority, const cpu_set_t *cpus);
+
+/**
+   Copy the newest frame into frame unless it was already taken. Never
+   blocks, called by Service_1 only.
+
+   \return true for a fresh frame, false if frame was left as it was
+ */
+bool capture_take(capture_t *c, cv::Mat &frame, uint64_t *time);
+
+/**
+   capture_take that waits for a fresh frame, for warming up only
+
+   \return false if the source ended first
+ */
+bool capture_wait(capture_t *c, cv::Mat &frame, uint64_t *time);
+
+/**
+   Stop and join the capture thread, which finishes the read it is in.
+ */
+void capture_stop(capture_t *c);
+
+#endif /* RTES_CAPTURE_H_ */
@@ -22,4 +22,26 @@ static const uint32_t USEC_PER_MSEC = 1000u;
 static const uint32_t NANOSEC_PER_SEC = 1000000000u;
 static const uint32_t NUM_CPU_CORES = 1u;
 
+// sequencer tick and the number of ticks between releases of each service
+static const uint32_t SEQUENCER_PERIOD_NSEC = 33333333u; // 30 Hz
+static const uint32_t S1_PERIOD_TICKS = 3u;
+static const uint32_t S2_PERIOD_TICKS = 4u;
+static const uint32_t S3_PERIOD_TICKS = 5u;
+
+// execution time budgets used by the static schedulability check, the p99
+// execution times at 320x240 in "analysis code/profiling results" rounded
+// up. Each service has one job there above its budget
+static const uint32_t SEQUENCER_BUDGET_USEC = 250u;
+static const uint32_t S1_BUDGET_USEC = 9100u;
+static const uint32_t S2_BUDGET_USEC = 50500u;
+static const uint32_t S3_BUDGET_USEC = 38500u;
+
+// worst execution times measured at 320x240. The CPU time budgets enforced
+// at run time are ENFORCE_MARGIN_PERCENT of these, the analysis budgets
+// above are exceeded by about one job in a hundred.
+static const uint32_t S1_WCET_USEC = 9200u;
+static const uint32_t S2_WCET_USEC = 57600u;
+static const uint32_t S3_WCET_USEC = 82200u;
+static const uint32_t ENFORCE_MARGIN_PERCENT = 125u;
+
 #endif /* RTES_CONSTANTS_H_ */
@@ -0,0 +1,112 @@
+
+/*
+** Copyright 2018 Benjamin J. Andre.
+** All Rights Reserved.
+**
+** This Source Code Form is subject to the terms of the Mozilla
+** Public License, v. 2.0. If a copy of the MPL was not distributed
+** with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/syscall.h>
+
+#include <errno.h>
+
+#include "deadline.hpp"
+
+#ifndef SCHED_DEADLINE
+#define SCHED_DEADLINE 6
+#endif
+
+#ifndef SYS_sched_setattr
+#if defined(__aarch64__)
+#define SYS_sched_setattr 274
+#elif defined(__arm__)
+#define SYS_sched_setattr 380
+#elif defined(__x86_64__)
+#define SYS_sched_setattr 314
+#endif
+#endif
+
+static const unsigned int MAX_LINE_LEN = 256;
+
+// glibc does not wrap sched_setattr, so carry our own copy of the kernel
+// structure rather than depend on the installed kernel headers.
+typedef struct {
+    uint32_t size;
+    uint32_t sched_policy;
+    uint64_t sched_flags;
+    int32_t sched_nice;
+    uint32_t sched_priority;
+    uint64_t sched_runtime;
+    uint64_t sched_deadline;
+    uint64_t sched_period;
+} dl_sched_attr_t;
+
+int read_deadline_params(const char *filename, deadline_params_t *params,
+                         unsigned int num)
+{
+    char line[MAX_LINE_LEN];
+    int configured = 0;
+    FILE *fptr;
+
+    memset(params, 0, num * sizeof(deadline_params_t));
+
+    fptr = fopen(filename, "r");
+    if (!fptr) {
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), fptr)) {
+        unsigned int id;
+        unsigned long long runtime, deadline, period;
+
+        if (line[0] == '#') {
+            continue;
+        }
+        if (sscanf(line, "%u , %llu , %llu , %llu", &id, &runtime,
+                   &deadline, &period) != 4) {
+            continue;
+        }
+        if (id >= num || runtime == 0 || runtime > deadline ||
+                deadline > period) {
+            printf("Ignoring invalid deadline parameters for id %u\n", id);
+            continue;
+        }
+
+        params[id].runtime = runtime;
+        params[id].deadline = deadline;
+        params[id].period = period;
+        configured++;
+    }
+
+    fclose(fptr);
+    return configured;
+}
+
+int enter_deadline_mode(const deadline_params_t *params)
+{
+    dl_sched_attr_t attr;
+
+    if (params->runtime == 0) {
+        return 0;
+    }
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.sched_policy = SCHED_DEADLINE;
+    attr.sched_runtime = params->runtime;
+    attr.sched_deadline = params->deadline;
+    attr.sched_period = params->period;
+
+    // pid 0 is the calling thread
+    if (syscall(SYS_sched_setattr, 0, &attr, 0) < 0) {
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,61 @@
+/**
+   \file deadline.hpp
+
+   SCHED_DEADLINE support for the service threads
+ */
+
+/*
+** Copyright 2018 Benjamin J. Andre.
+** All Rights Reserved.
+**
+** This Source Code Form is subject to the terms of the Mozilla
+** Public License, v. 2.0. If a copy of the MPL was not distributed
+** with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*/
+
+#ifndef RTES_DEADLINE_H_
+#define RTES_DEADLINE_H_
+
+#include <stdint.h>
+
+/**
+   Constant bandwidth server parameters for one thread, in nanoseconds.
+
+   A runtime of zero means the thread keeps its SCHED_FIFO priority.
+ */
+typedef struct {
+    uint64_t runtime;
+    uint64_t deadline;
+    uint64_t period;
+} deadline_params_t;
+
+/**
+   Read per-thread deadline parameters
+
+   Each non-comment line of the file is "id, runtime, deadline, period" with
+   the plog id of the thread and times in nanoseconds, as written by
+   "analysis code/deadline_params.py". Threads without a line are left with
+   a zero runtime.
+
+   \param[in] filename parameter file
+   \param[out] params array indexed by plog id
+   \param[in] num number of entries in params
+
+   \return number of threads configured, -1 on error
+ */
+int read_deadline_params(const char *filename, deadline_params_t *params,
+                         unsigned int num);
+
+/**
+   Switch the calling thread to SCHED_DEADLINE
+
+   Does nothing if params->runtime is zero. Requires root, and the kernel
+   rejects the request if the total bandwidth would not be schedulable.
+
+   \param[in] params server parameters
+
+   \return 0 on success, -1 on error with errno set
+ */
+int enter_deadline_mode(const deadline_params_t *params);
+
+#endif /* RTES_DEADLINE_H_ */
@@ -0,0 +1,103 @@
+
+/*
+** Copyright 2018 Benjamin J. Andre.
+** All Rights Reserved.
+**
+** This Source Code Form is subject to the terms of the Mozilla
+** Public License, v. 2.0. If a copy of the MPL was not distributed
+** with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*/
+
+#include "detect.hpp"
+
+using namespace cv;
+
+void detect_params_default(detect_params_t *params)
+{
+    params->motionThreshold = DEFAULT_MOTION_THRESHOLD;
+    params->redThreshold = DEFAULT_RED_THRESHOLD;
+    params->pauseMotion = DEFAULT_PAUSE_MOTION;
+    params->backgroundRate = DEFAULT_BACKGROUND_RATE;
+}
+
+bool sample_motion(const Mat &frame, const detect_params_t &params,
+                   Mat bgr[3], Mat &red, Mat &acc, Mat &accScaled,
+                   Mat &motion)
+{
+    split(frame, bgr);
+
+    bgr[2].copyTo(red);
+
+    // Scale it to 8-bit unsigned
+    convertScaleAbs(acc, accScaled);
+
+    absdiff(red, accScaled, motion);
+
+    threshold(motion, motion, params.motionThreshold, 255, THRESH_BINARY);
+
+    Scalar m = mean(motion);
+
+    //update the background model
+    accumulateWeighted(red, acc, params.backgroundRate);
+
+    return m.val[0] > params.pauseMotion;
+}
+
+void detect_lasers(const Mat &red, const Mat &motion, quality_level_t level,
+                   Rect roi, const detect_params_t &params,
+                   tracking_scratch_t &t)
+{
+    t.roi = Rect(0, 0, red.cols, red.rows);
+    t.scale = 1.0f;
+
+    if (level >= quality_roi) {
+        t.roi = roi & t.roi;
+    }
+
+    Mat r = red(t.roi);
+    Mat s = motion(t.roi);
+    int step = 1;
+
+    if (level >= quality_half_res) {
+        step = 2;
+        t.scale = 2.0f;
+    }
+
+    // masks are packed one bit per pixel from here until findContours,
+    // half resolution is taken while packing
+    bitmask_threshold(r, (uint8_t)params.redThreshold, step, &t.red);
+    bitmask_threshold(s, 0, step, &t.motion);
+
+    bitmask_t *rm = &t.red, *sm = &t.motion;
+    if (level < quality_no_blur) {
+        bitmask_median5(&t.red, &t.redMed, t.medianScratch);
+        bitmask_median5(&t.motion, &t.motionMed, t.medianScratch);
+        rm = &t.redMed;
+        sm = &t.motionMed;
+    }
+
+    bitmask_and(sm, rm, &t.both);
+    bitmask_unpack(&t.both, t.ba);
+
+    findContours(t.ba, t.contours, t.hierarchy, CV_RETR_CCOMP,
+                 CV_CHAIN_APPROX_SIMPLE);
+}
+
+void locate_lasers(tracking_scratch_t &t)
+{
+    unsigned int i;
+
+    t.contours_poly.resize(t.contours.size());
+    t.center.resize(t.contours.size());
+    t.radius.resize(t.contours.size());
+
+    // Approximate contour to polygon and get bounding circle
+    for (i = 0; i < t.contours.size(); i++) {
+        approxPolyDP(Mat(t.contours[i]), t.contours_poly[i], 3, true);
+        minEnclosingCircle((Mat)t.contours_poly[i], t.center[i], t.radius[i]);
+
+        // back to full frame coordinates
+        t.center[i].x = t.center[i].x * t.scale + t.roi.x;
+        t.center[i].y = t.center[i].y * t.scale + t.roi.y;
+    }
+}
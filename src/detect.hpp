@@ -0,0 +1,88 @@
+/**
+   \file detect.hpp
+
+   Laser detection shared by the services and batch-track: the motion mask
+   and background model of Service_1 and the blob detection of Service_2.
+ */
+
+/*
+** Copyright 2018 Benjamin J. Andre.
+** All Rights Reserved.
+**
+** This Source Code Form is subject to the terms of the Mozilla
+** Public License, v. 2.0. If a copy of the MPL was not distributed
+** with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*/
+
+#ifndef RTES_DETECT_H_
+#define RTES_DETECT_H_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "bitmask.hpp"
+#include "overload.hpp"
+
+/** defaults of detect_params_t, what the game was tuned with */
+static const int DEFAULT_MOTION_THRESHOLD = 25;
+static const int DEFAULT_RED_THRESHOLD = 170;
+static const double DEFAULT_PAUSE_MOTION = 20.0;
+static const double DEFAULT_BACKGROUND_RATE = 0.1;
+
+typedef struct {
+    int motionThreshold;    /*!< red change from the background that moves */
+    int redThreshold;       /*!< red level of a laser */
+    double pauseMotion;     /*!< mean of the motion mask, 0 to 255, above
+                                 which play pauses */
+    double backgroundRate;  /*!< weight of each frame in the background */
+} detect_params_t;
+
+void detect_params_default(detect_params_t *params);
+
+/**
+   Split a BGR frame into bgr, copy its red channel to red and threshold
+   the difference from the background model acc (CV_32FC1, frame size) into
+   the motion mask, then fold red into acc.
+
+   \return true when so much of the frame moved that play pauses
+ */
+bool sample_motion(const cv::Mat &frame, const detect_params_t &params,
+                   cv::Mat bgr[3], cv::Mat &red, cv::Mat &acc,
+                   cv::Mat &accScaled, cv::Mat &motion);
+
+/**
+   Buffers of detection, kept across frames so that once warmed up the
+   steady state does not allocate
+ */
+typedef struct {
+    bitmask_t red, motion, redMed, motionMed, both;
+    std::vector<uint64_t> medianScratch;
+    cv::Mat ba;
+    std::vector<std::vector<cv::Point> > contours;
+    std::vector<cv::Vec4i> hierarchy;
+    std::vector<std::vector<cv::Point> > contours_poly;
+    std::vector<cv::Point2f> center;
+    std::vector<float> radius;
+    cv::Rect roi;
+    float scale;
+} tracking_scratch_t;
+
+/**
+   Find the contours of the blobs that are both bright red and moving.
+   From quality_roi on only roi is searched, see quality_level_t for what
+   the other levels drop.
+ */
+void detect_lasers(const cv::Mat &red, const cv::Mat &motion,
+                   quality_level_t level, cv::Rect roi,
+                   const detect_params_t &params, tracking_scratch_t &t);
+
+/**
+   Bounding circle of each contour found by detect_lasers, centers in
+   full frame coordinates
+ */
+void locate_lasers(tracking_scratch_t &t);
+
+#endif /* RTES_DETECT_H_ */
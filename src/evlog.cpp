@@ -0,0 +1,252 @@
+
+/*
+** Copyright 2018 Benjamin J. Andre.
+** All Rights Reserved.
+**
+** This Source Code Form is subject to the terms of the Mozilla
+** Public License, v. 2.0. If a copy of the MPL was not distributed
+** with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*/
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <pthread.h>
+#include <syslog.h>
+#include <time.h>
+
+#include "constants.hpp"
+#include "evlog.hpp"
+
+static const size_t MAX_LINE_LEN = 256;
+
+// indexed by evlog_msg_t
+static const char *MSG_FORMATS[evlog_num_msgs] = {
+    "Sequencer thread started",
+    "Sequencer thread prior to delay",
+    "residual=%llu ns",
+    "Sequencer cycle %llu",
+    "Sequencer looping delay %llu",
+    "Sequencer release all sub-services",
+    "Sequencer pipeline %llu Service_%llu over budget, %llu jobs so far",
+    "Frame Sampler thread started",
+    "Frame Sampler release %llu",
+    "Tracking and collision detection thread started",
+    "Tracking and collision detection release %llu",
+    "pre-move obstacle collision, player %llu obstacle %llu",
+    "post-move obstacle collision, player %llu obstacle %llu",
+    "Rendering thread started",
+    "Rendering release %llu",
+};
+
+typedef struct {
+    uint64_t time;
+    uint32_t msg;
+    uint64_t args[EVLOG_MAX_ARGS];
+} evlog_entry_t;
+
+// single producer single consumer ring, the producer owns head and the
+// background thread owns tail, each on its own cache line
+typedef struct {
+    const char *name;
+    unsigned long long dropped;
+    volatile uint32_t head __attribute__((aligned(64)));
+    volatile uint32_t tail __attribute__((aligned(64)));
+    evlog_entry_t entries[EVLOG_RING_SIZE] __attribute__((aligned(64)));
+} evlog_ring_t;
+
+static evlog_ring_t rings[EVLOG_MAX_THREADS];
+static volatile unsigned int numRings = 0;
+static __thread evlog_ring_t *threadRing = NULL;
+
+static pthread_t writer;
+static volatile bool running = false;
+static FILE *output = NULL;
+static uint64_t startTime = 0;
+
+static uint64_t now_ns(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return (uint64_t)now.tv_sec * NANOSEC_PER_SEC + (uint64_t)now.tv_nsec;
+}
+
+void evlog(evlog_msg_t msg, uint64_t a0, uint64_t a1, uint64_t a2)
+{
+    evlog_ring_t *ring = threadRing;
+
+    if (!ring) {
+        return;
+    }
+
+    uint32_t head = ring->head;
+    if (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) >=
+            EVLOG_RING_SIZE) {
+        ring->dropped++;
+        return;
+    }
+
+    evlog_entry_t *e = &ring->entries[head & (EVLOG_RING_SIZE - 1)];
+    e->time = now_ns();
+    e->msg = msg;
+    e->args[0] = a0;
+    e->args[1] = a1;
+    e->args[2] = a2;
+
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+int evlog_register(const char *name)
+{
+    unsigned int i = __atomic_fetch_add(&numRings, 1, __ATOMIC_ACQ_REL);
+
+    if (i >= EVLOG_MAX_THREADS) {
+        return -1;
+    }
+
+    // touch the whole ring now rather than in the RT loop
+    memset(rings[i].entries, 0, sizeof(rings[i].entries));
+    rings[i].name = name;
+    threadRing = &rings[i];
+
+    return 0;
+}
+
+static void write_entry(const evlog_ring_t *ring, const evlog_entry_t *e)
+{
+    char line[MAX_LINE_LEN];
+    uint64_t t = (e->time > startTime) ? e->time - startTime : 0;
+    unsigned long long sec = t / NANOSEC_PER_SEC;
+    unsigned long long msec = (t % NANOSEC_PER_SEC) / 1000000u;
+
+    if (e->msg >= evlog_num_msgs) {
+        return;
+    }
+
+    snprintf(line, sizeof(line), MSG_FORMATS[e->msg],
+             (unsigned long long)e->args[0], (unsigned long long)e->args[1],
+             (unsigned long long)e->args[2]);
+
+    if (output) {
+        fprintf(output, "%s @ sec=%llu, msec=%llu: %s\n", ring->name, sec,
+                msec, line);
+    } else {
+        syslog(LOG_CRIT, "%s @ sec=%llu, msec=%llu: %s", ring->name, sec,
+               msec, line);
+    }
+}
+
+// write out everything logged so far, merged across threads in time order
+static void drain(void)
+{
+    unsigned int n = numRings < EVLOG_MAX_THREADS ? numRings :
+                     EVLOG_MAX_THREADS;
+    unsigned int i;
+
+    for (;;) {
+        evlog_ring_t *oldest = NULL;
+        const evlog_entry_t *first = NULL;
+
+        for (i = 0; i < n; i++) {
+            evlog_ring_t *ring = &rings[i];
+            uint32_t tail = ring->tail;
+
+            if (tail == __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE)) {
+                continue;
+            }
+            const evlog_entry_t *e =
+                &ring->entries[tail & (EVLOG_RING_SIZE - 1)];
+            if (!first || e->time < first->time) {
+                oldest = ring;
+                first = e;
+            }
+        }
+
+        if (!oldest) {
+            break;
+        }
+
+        write_entry(oldest, first);
+        __atomic_store_n(&oldest->tail, oldest->tail + 1, __ATOMIC_RELEASE);
+    }
+
+    if (output) {
+        fflush(output);
+    }
+}
+
+static void *writer_thread(void *context)
+{
+    struct timespec period = {0, EVLOG_FLUSH_MSEC * 1000000};
+    (void)context;
+
+    while (running) {
+        drain();
+        nanosleep(&period, NULL);
+    }
+    drain();
+
+    return NULL;
+}
+
+int evlog_start(const char *filename)
+{
+    pthread_attr_t attr;
+    int rc;
+
+    if (filename) {
+        output = fopen(filename, "a");
+        if (!output) {
+            return -1;
+        }
+    }
+
+    startTime = now_ns();
+    running = true;
+
+    // best effort, formatting must never compete with the services
+    pthread_attr_init(&attr);
+    pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+    pthread_attr_setschedpolicy(&attr, SCHED_OTHER);
+    rc = pthread_create(&writer, &attr, writer_thread, NULL);
+    pthread_attr_destroy(&attr);
+
+    if (rc != 0) {
+        running = false;
+        if (output) {
+            fclose(output);
+            output = NULL;
+        }
+        errno = rc;
+        return -1;
+    }
+
+    return 0;
+}
+
+void evlog_stop(void)
+{
+    if (!running) {
+        return;
+    }
+
+    running = false;
+    pthread_join(writer, NULL);
+
+    if (output) {
+        fclose(output);
+        output = NULL;
+    }
+}
+
+unsigned long long evlog_dropped(void)
+{
+    unsigned long long dropped = 0;
+    unsigned int i;
+
+    for (i = 0; i < EVLOG_MAX_THREADS; i++) {
+        dropped += rings[i].dropped;
+    }
+    return dropped;
+}
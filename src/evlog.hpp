@@ -0,0 +1,90 @@
+/**
+   \file evlog.hpp
+
+   Deferred formatting event logger for the RT threads.
+ */
+
+/*
+** Copyright 2018 Benjamin J. Andre.
+** All Rights Reserved.
+**
+** This Source Code Form is subject to the terms of the Mozilla
+** Public License, v. 2.0. If a copy of the MPL was not distributed
+** with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*/
+
+#ifndef RTES_EVLOG_H_
+#define RTES_EVLOG_H_
+
+#include <stdint.h>
+
+/** the sequencer and the services of every pipeline fit */
+static const unsigned int EVLOG_MAX_THREADS = 16u;
+static const unsigned int EVLOG_MAX_ARGS = 3u;
+/** entries per thread, a power of two */
+static const unsigned int EVLOG_RING_SIZE = 1024u;
+/** how often the background thread drains the rings */
+static const unsigned int EVLOG_FLUSH_MSEC = 50u;
+
+/**
+   Messages that can be logged. The RT side only records the id and the raw
+   arguments, the format strings live in evlog.cpp and are applied by the
+   background thread. Every argument is formatted as an unsigned long long.
+ */
+typedef enum evlog_msg_t_ {
+    evlog_seq_start = 0,
+    evlog_seq_delay,
+    evlog_seq_residual,
+    evlog_seq_cycle,
+    evlog_seq_looping,
+    evlog_seq_released,
+    evlog_seq_budget,
+    evlog_s1_start,
+    evlog_s1_release,
+    evlog_s2_start,
+    evlog_s2_release,
+    evlog_s2_pre_collision,
+    evlog_s2_post_collision,
+    evlog_s3_start,
+    evlog_s3_release,
+    evlog_num_msgs,
+} evlog_msg_t;
+
+/**
+   Start the background thread that formats the entries.
+
+   \param[in] filename file to append to, NULL for syslog
+
+   \return 0 on success, -1 with errno set
+ */
+int evlog_start(const char *filename);
+
+/**
+   Drain every ring one last time and stop the background thread.
+ */
+void evlog_stop(void);
+
+/**
+   Give the calling thread its own ring. Call during initialization, the
+   ring is touched here so logging does not page fault later. Threads that
+   never register log nothing.
+
+   \param[in] name prefix of the thread's formatted messages
+
+   \return 0 on success, -1 when all rings are taken
+ */
+int evlog_register(const char *name);
+
+/**
+   Record a message in the calling thread's ring. Lock free and wait free,
+   a full ring drops the entry and counts it.
+ */
+void evlog(evlog_msg_t msg, uint64_t a0 = 0, uint64_t a1 = 0,
+           uint64_t a2 = 0);
+
+/**
+   Entries dropped because a ring was full.
+ */
+unsigned long long evlog_dropped(void);
+
+#endif /* RTES_EVLOG_H_ */
@@ -0,0 +1,253 @@
+
+/*
+** Copyright 2018 Benjamin J. Andre.
+** All Rights Reserved.
+**
+** This Source Code Form is subject to the terms of the Mozilla
+** Public License, v. 2.0. If a copy of the MPL was not distributed
+** with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*/
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "constants.hpp"
+#include "executor.hpp"
+
+static_assert((EXECUTOR_QUEUE & (EXECUTOR_QUEUE - 1)) == 0,
+              "EXECUTOR_QUEUE must be a power of two");
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * NANOSEC_PER_SEC + ts.tv_nsec;
+}
+
+static void update_max(uint64_t *max, uint64_t value)
+{
+    uint64_t seen = __atomic_load_n(max, __ATOMIC_RELAXED);
+
+    while (value > seen &&
+            !__atomic_compare_exchange_n(max, &seen, value, false,
+                                         __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+// any worker may take from any queue, the compare and swap on tail decides
+// which one gets the job
+static executor_job_t *take(executor_queue_t *q)
+{
+    uint32_t tail = __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE);
+    executor_job_t *job;
+
+    for (;;) {
+        if (tail == __atomic_load_n(&q->head, __ATOMIC_ACQUIRE)) {
+            return NULL;
+        }
+        // the slot cannot be reused before tail moves past it
+        job = q->jobs[tail & (EXECUTOR_QUEUE - 1)];
+        if (__atomic_compare_exchange_n(&q->tail, &tail, tail + 1, false,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            return job;
+        }
+    }
+}
+
+static void run_job(executor_t *ex, executor_job_t *job, bool stolen)
+{
+    executor_stats_t *st = &ex->types[job->type];
+    uint64_t start = now_ns();
+    uint64_t delay = start - job->submitted;
+    uint64_t run;
+
+    job->run(job->context);
+    run = now_ns() - start;
+
+    __atomic_fetch_add(&st->completed, 1, __ATOMIC_RELAXED);
+    if (stolen) {
+        __atomic_fetch_add(&st->stolen, 1, __ATOMIC_RELAXED);
+    }
+    __atomic_fetch_add(&st->delayTotal, delay, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&st->runTotal, run, __ATOMIC_RELAXED);
+    update_max(&st->delayMax, delay);
+    update_max(&st->runMax, run);
+
+    // the sequencer may release the job again from here
+    __atomic_store_n(&job->pending, 0, __ATOMIC_RELEASE);
+}
+
+static void *worker_thread(void *context)
+{
+    executor_worker_t *w = (executor_worker_t *)context;
+    executor_t *ex = w->executor;
+    executor_job_t *job;
+    unsigned int i;
+    bool stolen;
+
+    for (;;) {
+        while (sem_wait(&ex->queued) < 0 && errno == EINTR) {
+        }
+
+        // a post can find its job already taken by a thief, then there
+        // is nothing to do until the next one
+        stolen = false;
+        job = take(&w->queue);
+        for (i = 1; job == NULL && i < ex->numWorkers; i++) {
+            job = take(&ex->workers[(w->index + i) % ex->numWorkers].queue);
+            stolen = (job != NULL);
+        }
+
+        if (job != NULL) {
+            run_job(ex, job, stolen);
+        } else if (ex->stop) {
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+void executor_init(executor_t *ex)
+{
+    memset(ex->types, 0, sizeof(ex->types));
+    ex->numTypes = 0;
+    ex->numWorkers = 0;
+    ex->running = false;
+}
+
+int executor_type(executor_t *ex, const char *name)
+{
+    if (ex->numTypes == EXECUTOR_MAX_TYPES) {
+        return -1;
+    }
+    snprintf(ex->types[ex->numTypes].name, EXECUTOR_NAME_LEN, "%s", name);
+    return (int)ex->numTypes++;
+}
+
+void executor_job_init(executor_job_t *job, unsigned int type,
+                       unsigned int period, void (*run)(void *),
+                       void *context)
+{
+    job->run = run;
+    job->context = context;
+    job->type = type;
+    job->period = (period > 0) ? period : 1;
+    job->pending = 0;
+    job->submitted = 0;
+}
+
+int executor_start(executor_t *ex, unsigned int numWorkers,
+                   const cpu_set_t *cpus)
+{
+    pthread_attr_t attr;
+    unsigned int i;
+    int rc = 0;
+
+    if (numWorkers < 1 || numWorkers > EXECUTOR_MAX_WORKERS) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    ex->stop = false;
+    ex->next = 0;
+    ex->numWorkers = numWorkers;
+    sem_init(&ex->queued, 0, 0);
+
+    for (i = 0; i < numWorkers; i++) {
+        ex->workers[i].executor = ex;
+        ex->workers[i].index = i;
+        ex->workers[i].queue.head = 0;
+        ex->workers[i].queue.tail = 0;
+    }
+
+    // best effort, background work must never compete with the services
+    pthread_attr_init(&attr);
+    pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+    pthread_attr_setschedpolicy(&attr, SCHED_OTHER);
+    if (cpus != NULL) {
+        pthread_attr_setaffinity_np(&attr, sizeof(*cpus), cpus);
+    }
+    for (i = 0; i < numWorkers && rc == 0; i++) {
+        rc = pthread_create(&ex->workers[i].thread, &attr, worker_thread,
+                            &ex->workers[i]);
+    }
+    pthread_attr_destroy(&attr);
+
+    // stop the workers already running
+    if (rc != 0) {
+        ex->numWorkers = i - 1;
+        ex->running = true;
+        executor_stop(ex);
+        errno = rc;
+        return -1;
+    }
+
+    ex->started = now_ns();
+    ex->running = true;
+    return 0;
+}
+
+bool executor_release(executor_t *ex, executor_job_t *job)
+{
+    executor_stats_t *st = &ex->types[job->type];
+    unsigned int i;
+
+    if (!ex->running) {
+        return false;
+    }
+
+    if (__atomic_load_n(&job->pending, __ATOMIC_ACQUIRE)) {
+        st->skipped++;
+        return false;
+    }
+    job->pending = 1;
+    job->submitted = now_ns();
+
+    // the next worker in turn, or the first after it with room
+    for (i = 0; i < ex->numWorkers; i++) {
+        unsigned int w = (ex->next + i) % ex->numWorkers;
+        executor_queue_t *q = &ex->workers[w].queue;
+        uint32_t head = q->head;
+
+        if (head - __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE) <
+                EXECUTOR_QUEUE) {
+            q->jobs[head & (EXECUTOR_QUEUE - 1)] = job;
+            __atomic_store_n(&q->head, head + 1, __ATOMIC_RELEASE);
+            ex->next = (w + 1) % ex->numWorkers;
+            st->released++;
+            sem_post(&ex->queued);
+            return true;
+        }
+    }
+
+    job->pending = 0;
+    st->rejected++;
+    return false;
+}
+
+void executor_stop(executor_t *ex)
+{
+    unsigned int i;
+
+    if (!ex->running) {
+        return;
+    }
+
+    // one post per worker beyond the queued jobs, each worker leaves on
+    // the first post that finds every queue empty
+    ex->stop = true;
+    for (i = 0; i < ex->numWorkers; i++) {
+        sem_post(&ex->queued);
+    }
+    for (i = 0; i < ex->numWorkers; i++) {
+        pthread_join(ex->workers[i].thread, NULL);
+    }
+
+    sem_destroy(&ex->queued);
+    ex->stopped = now_ns();
+    ex->running = false;
+}
@@ -0,0 +1,144 @@
+/**
+   \file executor.hpp
+
+   Work stealing pool of best effort threads that run the jobs released by
+   the sequencer, so background work does not need a thread of its own.
+ */
+
+/*
+** Copyright 2018 Benjamin J. Andre.
+** All Rights Reserved.
+**
+** This Source Code Form is subject to the terms of the Mozilla
+** Public License, v. 2.0. If a copy of the MPL was not distributed
+** with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*/
+
+#ifndef RTES_EXECUTOR_H_
+#define RTES_EXECUTOR_H_
+
+#include <stdint.h>
+
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+
+static const unsigned int EXECUTOR_MAX_WORKERS = 8u;
+static const unsigned int EXECUTOR_DEFAULT_WORKERS = 2u;
+static const unsigned int EXECUTOR_MAX_TYPES = 8u;
+
+/** jobs each worker can have queued, a power of two */
+static const unsigned int EXECUTOR_QUEUE = 16u;
+
+static const size_t EXECUTOR_NAME_LEN = 16u;
+
+/**
+   Best effort work released periodically by the sequencer. At most one
+   instance of a job is queued or running at a time, so run needs no
+   locking against itself, and a release while the previous one is still
+   pending is skipped.
+ */
+typedef struct {
+    void (*run)(void *context);
+    void *context;
+    unsigned int type;      /*!< from executor_type */
+    unsigned int period;    /*!< sequencer ticks between releases */
+    volatile int pending;   /*!< queued or running */
+    uint64_t submitted;     /*!< CLOCK_MONOTONIC ns of the last release */
+} executor_job_t;
+
+/**
+   Counters of one job type, updated by the workers and read at the end.
+   Delay is from release to a worker starting the job.
+ */
+typedef struct {
+    char name[EXECUTOR_NAME_LEN];
+    unsigned long long released;
+    unsigned long long completed;
+    unsigned long long stolen;    /*!< run by a worker other than the one queued on */
+    unsigned long long skipped;   /*!< previous release still pending */
+    unsigned long long rejected;  /*!< every queue full */
+    uint64_t delayTotal, delayMax;
+    uint64_t runTotal, runMax;
+} executor_stats_t;
+
+/**
+   Queue of one worker. The sequencer is the only producer and owns head,
+   every worker takes from tail with a compare and swap.
+ */
+typedef struct {
+    volatile uint32_t head __attribute__((aligned(64)));
+    volatile uint32_t tail __attribute__((aligned(64)));
+    executor_job_t *jobs[EXECUTOR_QUEUE];
+} executor_queue_t;
+
+typedef struct executor_t_ executor_t;
+
+typedef struct {
+    executor_t *executor;
+    unsigned int index;
+    pthread_t thread;
+    executor_queue_t queue;
+} executor_worker_t;
+
+/**
+   Released jobs are spread round robin over the workers' queues. A worker
+   runs the jobs of its own queue first and steals from the others when
+   it is empty, so one long job does not hold up the jobs behind it. The
+   workers run at SCHED_OTHER and sleep on a semaphore counting the queued
+   jobs.
+ */
+struct executor_t_ {
+    bool running;
+    volatile bool stop;
+    unsigned int numWorkers;
+    unsigned int next;      /*!< worker the next release is queued on */
+    sem_t queued;
+    uint64_t started, stopped;
+
+    executor_stats_t types[EXECUTOR_MAX_TYPES];
+    unsigned int numTypes;
+
+    executor_worker_t workers[EXECUTOR_MAX_WORKERS];
+};
+
+/**
+   Clear the pool, before any type is added.
+ */
+void executor_init(executor_t *ex);
+
+/**
+   Add a job type counted under name, before the pool starts.
+
+   \return type index, or -1 if there are EXECUTOR_MAX_TYPES already
+ */
+int executor_type(executor_t *ex, const char *name);
+
+/**
+   Set up a job that calls run(context) every period sequencer ticks
+ */
+void executor_job_init(executor_job_t *job, unsigned int type,
+                       unsigned int period, void (*run)(void *),
+                       void *context);
+
+/**
+   Start numWorkers threads restricted to cpus.
+
+   \return 0 on success, -1 with errno set
+ */
+int executor_start(executor_t *ex, unsigned int numWorkers,
+                   const cpu_set_t *cpus);
+
+/**
+   Queue job, called only by the sequencer. Never blocks.
+
+   \return false if the job was skipped or rejected
+ */
+bool executor_release(executor_t *ex, executor_job_t *job);
+
+/**
+   Run what is queued, then stop the workers.
+ */
+void executor_stop(executor_t *ex);
+
+#endif /* RTES_EXECUTOR_H_ */
@@ -0,0 +1,146 @@
+
+/*
+** Copyright 2018 Benjamin J. Andre.
+** All Rights Reserved.
+**
+** This Source Code Form is subject to the terms of the Mozilla
+** Public License, v. 2.0. If a copy of the MPL was not distributed
+** with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*/
+
+#include <math.h>
+
+#include <iostream>
+
+#include "frame_source.hpp"
+#include "gameutil.hpp"
+
+using namespace cv;
+
+static const int LASER_RADIUS = 4;
+static const double BACKGROUND_MAX = 96.0;
+
+FrameSource::FrameSource() : frames(0)
+{
+    config.kind = source_camera;
+    config.index = -1;
+    config.file = NULL;
+    config.once = false;
+    stream.fd = -1;
+    stream.data = NULL;
+}
+
+FrameSource::~FrameSource()
+{
+    if (config.kind == source_mjpeg) {
+        mjpeg_close(&stream);
+    }
+}
+
+int FrameSource::open(const frame_source_config_t &cfg)
+{
+    config = cfg;
+    frames = 0;
+
+    switch (config.kind) {
+    case source_camera:
+        if (config.index < 0) {
+            return init_camera(&cap, config.size.width, config.size.height);
+        }
+        cap.open(config.index);
+        if (!cap.isOpened()) {
+            std::cout << "Failed to open camera " << config.index << std::endl;
+            return -1;
+        }
+        cap.set(CV_CAP_PROP_FRAME_WIDTH, config.size.width);
+        cap.set(CV_CAP_PROP_FRAME_HEIGHT, config.size.height);
+        return 1;
+
+    case source_replay:
+        return init_replay(&cap, config.file);
+
+    case source_mjpeg:
+        if (mjpeg_open(&stream, config.file) < 0) {
+            std::cout << "Failed to open MJPEG recording " << config.file
+                      << std::endl;
+            return -1;
+        }
+        return 1;
+
+    case source_synthetic:
+        background.create(config.size, CV_8UC3);
+        theRNG().state = 0x5eed + config.index;
+        randu(background, Scalar::all(0), Scalar::all(BACKGROUND_MAX));
+        return 1;
+    }
+
+    return -1;
+}
+
+void FrameSource::synthesize(Mat &frame)
+{
+    double t = (double)frames / 10.0;
+    double phase = config.index * 1.3;
+    int w = config.size.width, h = config.size.height;
+    Point laser((int)(w / 2 + 0.4 * w * sin(0.7 * t + phase)),
+                (int)(h / 2 + 0.4 * h * sin(1.1 * t + 2.0 * phase)));
+
+    background.copyTo(frame);
+    circle(frame, laser, LASER_RADIUS, Scalar(60, 60, 255), -1, 8, 0);
+}
+
+// decode at the smallest DCT scale covering the pipeline size, only a
+// recording with a different aspect ratio needs a resize of the already
+// small image
+bool FrameSource::read_mjpeg(Mat &frame)
+{
+    size_t previous = stream.offset;
+    const uint8_t *data;
+    size_t len;
+
+    if (mjpeg_next(&stream, &data, &len) < 0) {
+        return !config.once;
+    }
+
+    // the recording rewound to find this frame
+    if (config.once && (size_t)(data - stream.data) < previous) {
+        return false;
+    }
+
+    if (decoder.decode(data, len, config.size, scaled) < 0) {
+        // keep the previous frame rather than handing on a torn one
+        return true;
+    }
+
+    if (scaled.size() == config.size) {
+        scaled.copyTo(frame);
+    } else {
+        resize(scaled, frame, config.size, 0, 0, INTER_AREA);
+    }
+    return true;
+}
+
+bool FrameSource::read(Mat &frame)
+{
+    frames++;
+
+    if (config.kind == source_synthetic) {
+        synthesize(frame);
+        return true;
+    }
+
+    if (config.kind == source_mjpeg) {
+        return read_mjpeg(frame);
+    }
+
+    cap >> frame;
+
+    if (frame.empty() && config.kind == source_replay) {
+        if (config.once) {
+            return false;
+        }
+        cap.set(CV_CAP_PROP_POS_FRAMES, 0);
+        cap >> frame;
+    }
+    return true;
+}
@@ -0,0 +1,77 @@
+/**
+   \file frame_source.hpp
+
+   Where a pipeline's frames come from: a camera, a recording or a
+   synthetic generator.
+ */
+
+/*
+** Copyright 2018 Benjamin J. Andre.
+** All Rights Reserved.
+**
+** This Source Code Form is subject to the terms of the Mozilla
+** Public License, v. 2.0. If a copy of the MPL was not distributed
+** with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*/
+
+#ifndef RTES_FRAME_SOURCE_H_
+#define RTES_FRAME_SOURCE_H_
+
+#include <opencv2/opencv.hpp>
+
+#include "mjpeg.hpp"
+
+typedef enum frame_source_kind_t_ {
+    source_camera = 0,  /*!< live camera */
+    source_replay,      /*!< recorded video, rewound at the end */
+    source_synthetic,   /*!< generated frames with a moving laser */
+    source_mjpeg,       /*!< raw MJPEG recording, decoded at reduced scale */
+} frame_source_kind_t;
+
+typedef struct {
+    frame_source_kind_t kind;
+    int index;            /*!< camera index, -1 for the first that opens */
+    const char *file;     /*!< replay and mjpeg only */
+    bool once;            /*!< replay and mjpeg only, end instead of
+                               rewinding */
+    cv::Size size;
+} frame_source_config_t;
+
+/**
+   Delivers frames of a fixed size to the frame service.
+
+   Synthetic frames are a fixed noisy background with one red laser dot
+   moving along a Lissajous path, so tracking and rendering do realistic
+   work without a camera. The path depends on the index so each pipeline
+   sees a different laser.
+
+   MJPEG recordings bypass VideoCapture, which fully decodes every frame to
+   BGR, and are decoded with DCT scaling straight to the pipeline size.
+ */
+class FrameSource
+{
+  public:
+    FrameSource();
+    ~FrameSource();
+
+    int open(const frame_source_config_t &config);
+
+    /**
+       Next frame, false once a recording played once has ended
+     */
+    bool read(cv::Mat &frame);
+
+  private:
+    void synthesize(cv::Mat &frame);
+    bool read_mjpeg(cv::Mat &frame);
+
+    frame_source_config_t config;
+    cv::VideoCapture cap;
+    cv::Mat background;
+    mjpeg_stream_t stream;
+    MjpegDecoder decoder;
+    cv::Mat scaled;
+    unsigned long long frames;
+};
+
+#endif /* RTES_FRAME_SOURCE_H_ */
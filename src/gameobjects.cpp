@@ -13,6 +13,12 @@
 #define PLAYER_COLOR_1 Scalar(0,0,0)
 #define PLAYER_COLOR_2 Scalar(200,200,200)
 
+Goal::Goal()
+{
+  pos = Point(0,0);
+  size = 15;
+}
+
 Goal::Goal(Point position, int radius)
 {
   pos = position;
@@ -24,6 +30,11 @@ void Goal::draw(Mat image)
   circle(image, pos, size, GOAL_COLOR, GOAL_THICKNESS,8,0);
 }
 
+void Goal::prepare(SpriteAtlas &atlas) const
+{
+  atlas.prepare_ring(size, GOAL_COLOR, GOAL_THICKNESS);
+}
+
 Obstacle::Obstacle()
 {
   pos = Point(0,0);
@@ -49,10 +60,27 @@ void Obstacle::draw(Mat image)
   circle(image, pos, size, OBSTACLE_COLOR, OBSTACLE_THICKNESS,8,0);
 }
 
+void Obstacle::prepare(SpriteAtlas &atlas) const
+{
+  atlas.prepare_ring(size, OBSTACLE_COLOR, OBSTACLE_THICKNESS);
+}
+
+Player::Player()
+{
+  pos = Point(0,0);
+  size = 10;
+  score = 0;
+  collided = false;
+  joined = false;
+}
+
 Player::Player(Point position, int radius)
 {
   pos = position;
   size = radius;
+  score = 0;
+  collided = false;
+  joined = false;
 }
 
 void Player::reposition(Point position)
@@ -66,6 +94,12 @@ void Player::draw(Mat image)
   circle(image, pos, size, PLAYER_COLOR_2, PLAYER_THICKNESS,8,0);
 }
 
+void Player::prepare(SpriteAtlas &atlas) const
+{
+  atlas.prepare_ring(size - PLAYER_THICKNESS, PLAYER_COLOR_1, PLAYER_THICKNESS);
+  atlas.prepare_ring(size, PLAYER_COLOR_2, PLAYER_THICKNESS);
+}
+
 int move_all(Vector<Obstacle> &goCollection)
 {
   unsigned int i;
@@ -88,6 +122,50 @@ int draw_all(Mat image, Vector<GameObj*> &goCollection)
   return 0;
 }
 
+int draw_goals(Mat image, const Goal *goals, unsigned int n, SpriteAtlas &atlas)
+{
+  unsigned int i;
+  for(i = 0; i < n; ++i)
+  {
+    blit_sprite(image, atlas.ring(goals[i].size, GOAL_COLOR, GOAL_THICKNESS),
+                goals[i].pos);
+  }
+
+  return 0;
+}
+
+int draw_obstacles(Mat image, const Obstacle *obstacles, unsigned int n,
+                   SpriteAtlas &atlas)
+{
+  unsigned int i;
+  for(i = 0; i < n; ++i)
+  {
+    blit_sprite(image, atlas.ring(obstacles[i].size, OBSTACLE_COLOR,
+                                  OBSTACLE_THICKNESS), obstacles[i].pos);
+  }
+
+  return 0;
+}
+
+int draw_players(Mat image, const Player *players, unsigned int n,
+                 SpriteAtlas &atlas)
+{
+  unsigned int i;
+  for(i = 0; i < n; ++i)
+  {
+    if(!players[i].joined)
+    {
+      continue;
+    }
+    blit_sprite(image, atlas.ring(players[i].size - PLAYER_THICKNESS,
+                                  PLAYER_COLOR_1, PLAYER_THICKNESS), players[i].pos);
+    blit_sprite(image, atlas.ring(players[i].size, PLAYER_COLOR_2,
+                                  PLAYER_THICKNESS), players[i].pos);
+  }
+
+  return 0;
+}
+
 int detect_collision(GameObj &go1, GameObj &go2)
 {
   int distance = sqrt(SQUARE(go1.pos.x - go2.pos.x) + SQUARE(go1.pos.y - go1.pos.y));
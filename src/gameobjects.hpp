@@ -4,6 +4,8 @@
 #include <opencv2/opencv.hpp>
 #include <vector>
 
+#include "overlay.hpp"
+
 using namespace cv;
 using namespace std;
 
@@ -18,8 +20,10 @@ class GameObj
 class Goal: public GameObj
 {
   public:
+    Goal();
     Goal(Point position, int radius);
     void draw(Mat image);
+    void prepare(SpriteAtlas &atlas) const;
 };
 
 class Obstacle: public GameObj
@@ -30,18 +34,32 @@ class Obstacle: public GameObj
     Obstacle(Point position, int radius, Point moveSpeed);
     void move();
     void draw(Mat image);
+    void prepare(SpriteAtlas &atlas) const;
 };
 
 class Player: public GameObj
 {
   public:
+    int score;
+    bool collided;
+    bool joined;
+    Player();
     Player(Point position, int radius);
     void reposition(Point position);
     void draw(Mat image);
+    void prepare(SpriteAtlas &atlas) const;
 };
 
 int move_all(Vector<Obstacle> &goCollection);
 int draw_all(Mat image, Vector<GameObj*> &goCollection);
+
+// batched, non-virtual drawing from pre-rendered sprites. prepare() each
+// object during initialization so the atlas does not render in the loop.
+int draw_goals(Mat image, const Goal *goals, unsigned int n, SpriteAtlas &atlas);
+int draw_obstacles(Mat image, const Obstacle *obstacles, unsigned int n,
+                   SpriteAtlas &atlas);
+int draw_players(Mat image, const Player *players, unsigned int n,
+                 SpriteAtlas &atlas);
 int detect_collision(GameObj &go1, GameObj &go2);
 // int detect_collision(GameObj &go1, Vector<GameObj*> &goCollection);
 
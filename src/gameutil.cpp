@@ -1,20 +1,74 @@
 #include "gameutil.hpp"
+#include "overlay.hpp"
 #include <iostream>
 #include <string>
-#include <sstream>
 
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/videodev2.h>
 
-#define SSTR( x ) static_cast< std::ostringstream & >( ( std::ostringstream() << std::dec << x ) ).str()
 
 #define RETRY_NUM 5
 #define SCORE_POS Point(30,30)
 #define TEXT_COLOR Scalar(200,200,250)
 #define TEXT_SIZE 1
+#define TEXT_FONT FONT_HERSHEY_COMPLEX_SMALL
+#define SCORE_LABEL "Score: "
+#define PLAYER_LABEL "P"
+#define PLAYER_SEPARATOR ": "
+#define SCORE_LINE_HEIGHT 20
+#define STATUS_COLOR Scalar(100,100,100)
+
+static GlyphCache *scoreGlyphs = 0;
+static GlyphCache *statusGlyphs = 0;
+static pthread_once_t uiOnce = PTHREAD_ONCE_INIT;
+
+// true when /dev/video<index> is a V4L2 capture device. Asking the driver
+// takes microseconds, where a VideoCapture open of a missing or output
+// only node can block for a long time before it fails.
+static bool is_capture_device(int index)
+{
+    struct v4l2_capability caps;
+    char path[32];
+    uint32_t flags;
+    int fd;
+
+    snprintf(path, sizeof(path), "/dev/video%d", index);
+    fd = open(path, O_RDWR | O_NONBLOCK);
+    if (fd < 0) {
+        return false;
+    }
+    if (ioctl(fd, VIDIOC_QUERYCAP, &caps) < 0) {
+        close(fd);
+        return false;
+    }
+    close(fd);
+
+    flags = (caps.capabilities & V4L2_CAP_DEVICE_CAPS) ? caps.device_caps :
+            caps.capabilities;
+    return (flags & V4L2_CAP_VIDEO_CAPTURE) != 0;
+}
 
 int init_camera(VideoCapture *cap, int hres, int vres)
 {
     int i;
+
+    // open the first node the driver reports as a camera, and only fall
+    // back to trying each index when none does (e.g. no V4L2 backend)
     for (i = 0; i < RETRY_NUM; ++i) {
+        if (is_capture_device(i)) {
+            cap->open(i);
+            if (cap->isOpened()) {
+                break;
+            }
+            cout << "Failed to open camera " << i << endl;
+        }
+    }
+
+    for (i = 0; i < RETRY_NUM && !cap->isOpened(); ++i) {
         cap->open(i);
 
         if (!cap->isOpened()) {
@@ -35,11 +89,63 @@ int init_camera(VideoCapture *cap, int hres, int vres)
     return 1;
 }
 
+int init_replay(VideoCapture *cap, const std::string &filename)
+{
+    cap->open(filename);
+
+    if (!cap->isOpened()) {
+        cout << "Failed to open recording " << filename << endl;
+        return -1;
+    }
+
+    return 1;
+}
+
+
+static void create_glyphs(void)
+{
+    scoreGlyphs = new GlyphCache(TEXT_FONT, TEXT_SIZE, TEXT_COLOR, 1);
+    scoreGlyphs->prepare_label(SCORE_LABEL);
+    scoreGlyphs->prepare_label(PLAYER_LABEL);
+    scoreGlyphs->prepare_label(PLAYER_SEPARATOR);
+    scoreGlyphs->prepare_label("-");
+
+    statusGlyphs = new GlyphCache(TEXT_FONT, TEXT_SIZE, STATUS_COLOR, 1);
+    statusGlyphs->prepare_label("Game Paused");
+}
+
+// the renderers of every pipeline start at once and share the glyphs
+void init_ui(void)
+{
+    pthread_once(&uiOnce, create_glyphs);
+}
 
 void write_ui(Mat image, int score)
 {
-    std::string scoreString = "Score: " + SSTR(score);
+    Point pos = scoreGlyphs->draw_label(image, SCORE_LABEL, SCORE_POS);
 
-    putText(image, scoreString, SCORE_POS, FONT_HERSHEY_COMPLEX_SMALL, TEXT_SIZE,
-            TEXT_COLOR, 1, CV_AA);
+    if (score < 0) {
+        pos = scoreGlyphs->draw_label(image, "-", pos);
+        score = -score;
+    }
+    scoreGlyphs->draw_number(image, (unsigned int)score, pos);
+}
+
+void write_player_ui(Mat image, unsigned int player, int score)
+{
+    Point pos(SCORE_POS.x, SCORE_POS.y + (int)player * SCORE_LINE_HEIGHT);
+
+    pos = scoreGlyphs->draw_label(image, PLAYER_LABEL, pos);
+    pos = scoreGlyphs->draw_number(image, player + 1, pos);
+    pos = scoreGlyphs->draw_label(image, PLAYER_SEPARATOR, pos);
+    if (score < 0) {
+        pos = scoreGlyphs->draw_label(image, "-", pos);
+        score = -score;
+    }
+    scoreGlyphs->draw_number(image, (unsigned int)score, pos);
+}
+
+void write_status(Mat image, const std::string &status, Point pos)
+{
+    statusGlyphs->draw_label(image, status, pos);
 }
@@ -1,6 +1,8 @@
 #ifndef GAME_UTIL_HPP
 #define GAME_UTIL_HPP
 
+#include <string>
+
 #include <opencv2/opencv.hpp>
 
 using namespace cv;
@@ -8,6 +10,17 @@ using namespace std;
 
 int init_camera(VideoCapture *cap, int hres, int vres);
 
+// recorded frames at the game resolution, in place of the camera
+int init_replay(VideoCapture *cap, const std::string &filename);
+
+// pre-render the ui glyphs, must be called before write_ui/write_status
+void init_ui(void);
+
 void write_ui(Mat image, int score);
 
+// per player score line for multi-player games, one row per player
+void write_player_ui(Mat image, unsigned int player, int score);
+
+void write_status(Mat image, const std::string &status, Point pos);
+
 #endif
@@ -15,6 +15,8 @@
 #include <semaphore.h>
 
 #include "globals.hpp"
+#include "overload.hpp"
+#include "telemetry.hpp"
 
 // FIXME(bja, 2018-04) these need to be protected. should probably be moved into
 // modules for each service.
@@ -26,6 +28,9 @@ sem_t semS2;
 int abortS3 = false;
 sem_t semS3;
 struct timeval start_time_val;
+overload_t overload;
+// NULL when the shared memory segment could not be created
+telemetry_t *telemetry = NULL;
 
 /**
 
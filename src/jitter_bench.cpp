@@ -0,0 +1,468 @@
+
+/*
+** Copyright 2018 Benjamin J. Andre.
+** All Rights Reserved.
+**
+** This Source Code Form is subject to the terms of the Mozilla
+** Public License, v. 2.0. If a copy of the MPL was not distributed
+** with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*/
+
+// Cyclictest style release jitter benchmark.
+//
+// Runs the real sequencer against dummy services that burn a configurable
+// amount of CPU per job, optionally with interference threads competing for
+// the CPU, memory bandwidth, the last level cache and the block layer. For
+// every release of every service it records:
+//
+//   release latency - when the sequencer posted the release compared to the
+//                     ideal grid (first release + n * service period)
+//   wakeup latency  - when the service started running compared to the
+//                     time the sequencer posted the release
+//
+// and prints min/avg/max per service plus an optional histogram file, so
+// kernels, cpu partitioning and sequencer implementations can be compared on
+// the same machine.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <fcntl.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <time.h>
+
+#include "constants.hpp"
+#include "budget.hpp"
+#include "overload.hpp"
+#include "plog.hpp"
+#include "sequencer.hpp"
+#include "thread_context.hpp"
+
+extern int abortS1;
+extern sem_t semS1;
+extern int abortS2;
+extern sem_t semS2;
+extern int abortS3;
+extern sem_t semS3;
+extern overload_t overload;
+
+static const uint64_t NSEC_PER_USEC = 1000u;
+static const size_t MEM_HOG_BYTES = 64u * 1024u * 1024u;
+static const size_t IO_HOG_BLOCK = 1024u * 1024u;
+static const size_t IO_HOG_FILE_BYTES = 256u * 1024u * 1024u;
+static const size_t CACHE_LINE = 64u;
+static const unsigned int MAX_HOGS = 64u;
+
+typedef struct {
+    uint64_t min;
+    uint64_t max;
+    uint64_t sum;
+    unsigned long long count;
+    unsigned long long overflow;
+    unsigned long long *buckets;
+} latency_stats_t;
+
+typedef struct {
+    unsigned int id;
+    int *abort;
+    sem_t *sem;
+    uint64_t period;
+    uint64_t load;
+    latency_stats_t release;
+    latency_stats_t wakeup;
+} bench_service_t;
+
+typedef enum hog_kind_t_ {
+    hog_cpu,
+    hog_memory,
+    hog_cache,
+    hog_io,
+} hog_kind_t;
+
+typedef struct {
+    hog_kind_t kind;
+    size_t cacheBytes;
+} hog_params_t;
+
+static volatile bool stopHogs = false;
+static uint64_t bucketWidth = 10u * NSEC_PER_USEC;
+static unsigned int numBuckets = 1000u;
+
+static uint64_t timespec_ns(const struct timespec *t)
+{
+    return (uint64_t)t->tv_sec * NANOSEC_PER_SEC + (uint64_t)t->tv_nsec;
+}
+
+static uint64_t now_ns(clockid_t clock)
+{
+    struct timespec t;
+    clock_gettime(clock, &t);
+    return timespec_ns(&t);
+}
+
+static void stats_init(latency_stats_t *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    stats->min = UINT64_MAX;
+    stats->buckets = (unsigned long long *)calloc(numBuckets,
+                     sizeof(unsigned long long));
+}
+
+static void stats_add(latency_stats_t *stats, int64_t latency)
+{
+    uint64_t value = (latency < 0) ? 0 : (uint64_t)latency;
+    uint64_t bucket = value / bucketWidth;
+
+    stats->min = (value < stats->min) ? value : stats->min;
+    stats->max = (value > stats->max) ? value : stats->max;
+    stats->sum += value;
+    stats->count++;
+    if (bucket < numBuckets) {
+        stats->buckets[bucket]++;
+    } else {
+        stats->overflow++;
+    }
+}
+
+// burn the job's budget of cpu time, preemption does not shorten it
+static void burn(uint64_t load)
+{
+    uint64_t start = now_ns(CLOCK_THREAD_CPUTIME_ID);
+    while (now_ns(CLOCK_THREAD_CPUTIME_ID) - start < load) {
+    }
+}
+
+static void *dummy_service(void *context)
+{
+    bench_service_t *service = (bench_service_t *)context;
+    overload_service_t *log = &overload.services[service->id];
+    unsigned long long job = 0;
+    uint64_t first = 0;
+
+    while (!*service->abort) {
+        sem_wait(service->sem);
+        uint64_t woke = now_ns(CLOCK_REALTIME);
+
+        if (*service->abort || log->released <= job) {
+            break;
+        }
+
+        const overload_stamp_t *stamp =
+            &log->release[job % OVERLOAD_RELEASE_HISTORY];
+        uint64_t release = timespec_ns(&stamp->time);
+        if (job == 0) {
+            first = release;
+        }
+
+        // no stamp for releases that found the ring full
+        if (stamp->release == job) {
+            stats_add(&service->release,
+                      (int64_t)(release - (first + job * service->period)));
+            stats_add(&service->wakeup, (int64_t)(woke - release));
+        }
+
+        burn(service->load);
+        overload_complete(&overload, service->id);
+        job++;
+    }
+
+    return NULL;
+}
+
+static void *hog(void *context)
+{
+    hog_params_t *params = (hog_params_t *)context;
+    volatile double x = 1.0;
+    char *a = NULL, *b = NULL;
+    size_t lines, index = 1, written = 0;
+    char path[] = "/tmp/jitter-bench-XXXXXX";
+    int fd = -1;
+
+    switch (params->kind) {
+    case hog_cpu:
+        while (!stopHogs) {
+            x = x * 1.0000001 + 1.0;
+        }
+        break;
+
+    case hog_memory:
+        a = (char *)malloc(MEM_HOG_BYTES);
+        b = (char *)malloc(MEM_HOG_BYTES);
+        memset(a, 1, MEM_HOG_BYTES);
+        memset(b, 2, MEM_HOG_BYTES);
+        while (!stopHogs) {
+            memcpy(b, a, MEM_HOG_BYTES);
+            memcpy(a, b, MEM_HOG_BYTES);
+        }
+        break;
+
+    case hog_cache:
+        // pseudo random cache line walk over a buffer larger than the LLC
+        a = (char *)calloc(params->cacheBytes, 1);
+        lines = params->cacheBytes / CACHE_LINE;
+        while (!stopHogs) {
+            index = (index * 1103515245u + 12345u) % lines;
+            a[index * CACHE_LINE]++;
+        }
+        break;
+
+    case hog_io:
+        a = (char *)malloc(IO_HOG_BLOCK);
+        memset(a, 3, IO_HOG_BLOCK);
+        fd = mkstemp(path);
+        if (fd < 0) {
+            perror("io hog mkstemp");
+            break;
+        }
+        unlink(path);
+        while (!stopHogs) {
+            if (write(fd, a, IO_HOG_BLOCK) < 0) {
+                perror("io hog write");
+                break;
+            }
+            written += IO_HOG_BLOCK;
+            if (written >= IO_HOG_FILE_BYTES) {
+                fsync(fd);
+                lseek(fd, 0, SEEK_SET);
+                written = 0;
+            }
+        }
+        close(fd);
+        break;
+    }
+
+    free(a);
+    free(b);
+    return NULL;
+}
+
+static void print_stats(const char *name, const latency_stats_t *stats)
+{
+    if (stats->count == 0) {
+        printf("  %-8s no samples\n", name);
+        return;
+    }
+    printf("  %-8s samples %8llu  min %8.1f  avg %8.1f  max %8.1f us"
+           "  overflow %llu\n", name, stats->count,
+           (double)stats->min / NSEC_PER_USEC,
+           (double)stats->sum / stats->count / NSEC_PER_USEC,
+           (double)stats->max / NSEC_PER_USEC, stats->overflow);
+}
+
+static void write_histogram(const char *filename, bench_service_t *services)
+{
+    FILE *fptr = fopen(filename, "w");
+    unsigned int b, i;
+
+    if (!fptr) {
+        perror(filename);
+        return;
+    }
+
+    fprintf(fptr, "# latency_us");
+    for (i = 0; i < NUM_SERVICES; i++) {
+        fprintf(fptr, " release%u wakeup%u", services[i].id, services[i].id);
+    }
+    fprintf(fptr, "\n");
+
+    for (b = 0; b < numBuckets; b++) {
+        fprintf(fptr, "%llu", (unsigned long long)(b * bucketWidth /
+                NSEC_PER_USEC));
+        for (i = 0; i < NUM_SERVICES; i++) {
+            fprintf(fptr, " %llu %llu", services[i].release.buckets[b],
+                    services[i].wakeup.buckets[b]);
+        }
+        fprintf(fptr, "\n");
+    }
+
+    fprintf(fptr, "# overflow");
+    for (i = 0; i < NUM_SERVICES; i++) {
+        fprintf(fptr, " %llu %llu", services[i].release.overflow,
+                services[i].wakeup.overflow);
+    }
+    fprintf(fptr, "\n");
+    fclose(fptr);
+}
+
+static void usage(const char *name)
+{
+    printf("usage: %s [options]\n", name);
+    printf("  -n periods  sequencer periods to run (default 900, 30 s)\n");
+    printf("  -a          absolute sequencer releases (default relative)\n");
+    printf("  -w a,b,c    cpu time per job of services 1-3 in us\n");
+    printf("  -c n        cpu hog threads\n");
+    printf("  -m n        memory bandwidth hog threads\n");
+    printf("  -k n        cache thrashing threads\n");
+    printf("  -K mb       cache thrashing buffer size (default 16)\n");
+    printf("  -i n        io hog threads\n");
+    printf("  -b us       histogram bucket width (default 10)\n");
+    printf("  -B n        histogram buckets (default 1000)\n");
+    printf("  -o file     write the latency histograms to file\n");
+}
+
+int main(int argc, char **argv)
+{
+    threadParams_t seqParams;
+    bench_service_t services[NUM_SERVICES];
+    hog_params_t hogParams[MAX_HOGS];
+    pthread_t serviceThreads[NUM_SERVICES], seqThread, hogThreads[MAX_HOGS];
+    pthread_attr_t attr;
+    struct sched_param param;
+    unsigned long long periods = 900;
+    unsigned int hogs[4] = {0, 0, 0, 0};
+    unsigned int loads[NUM_SERVICES] = {5000, 10000, 10000};
+    unsigned int numHogs = 0, i, k;
+    size_t cacheBytes = 16u * 1024u * 1024u;
+    const char *histogramFile = NULL;
+    int maxPrio = sched_get_priority_max(SCHED_FIFO);
+    int opt, rc;
+
+    memset(&seqParams, 0, sizeof(seqParams));
+    seqParams.sleep = sequencer_relative;
+    seqParams.traceFile = "jitter-trace.csv";
+
+    while ((opt = getopt(argc, argv, "n:aw:c:m:k:K:i:b:B:o:h")) != -1) {
+        switch (opt) {
+        case 'n':
+            periods = strtoull(optarg, NULL, 10);
+            break;
+        case 'a':
+            seqParams.sleep = sequencer_absolute;
+            break;
+        case 'w':
+            sscanf(optarg, "%u,%u,%u", &loads[0], &loads[1], &loads[2]);
+            break;
+        case 'c':
+            hogs[hog_cpu] = atoi(optarg);
+            break;
+        case 'm':
+            hogs[hog_memory] = atoi(optarg);
+            break;
+        case 'k':
+            hogs[hog_cache] = atoi(optarg);
+            break;
+        case 'K':
+            cacheBytes = (size_t)atoi(optarg) * 1024u * 1024u;
+            break;
+        case 'i':
+            hogs[hog_io] = atoi(optarg);
+            break;
+        case 'b':
+            bucketWidth = (uint64_t)atoi(optarg) * NSEC_PER_USEC;
+            break;
+        case 'B':
+            numBuckets = atoi(optarg);
+            break;
+        case 'o':
+            histogramFile = optarg;
+            break;
+        case 'h':
+            usage(argv[0]);
+            exit(0);
+        default:
+            usage(argv[0]);
+            exit(-1);
+        }
+    }
+
+    if (bucketWidth == 0 || numBuckets == 0) {
+        usage(argv[0]);
+        exit(-1);
+    }
+
+    overload_init(&overload, NULL);
+
+    int *aborts[NUM_SERVICES] = {&abortS1, &abortS2, &abortS3};
+    sem_t *sems[NUM_SERVICES] = {&semS1, &semS2, &semS3};
+    release_group_t group;
+    budget_t budgets[NUM_SERVICES];
+
+    // the dummy services burn a set load, their budgets are not enforced
+    for (i = 0; i < NUM_SERVICES; i++) {
+        budget_init(&budgets[i], 0, NULL, i + 1);
+        group.sems[i] = sems[i];
+        group.aborts[i] = aborts[i];
+        group.budgets[i] = &budgets[i];
+        group.violations[i] = 0;
+    }
+    group.overload = &overload;
+    group.telemetry = NULL;
+    seqParams.groups = &group;
+    seqParams.numGroups = 1;
+
+    // best effort interference first so it is running when measuring starts
+    for (k = hog_cpu; k <= hog_io; k++) {
+        for (i = 0; i < hogs[k] && numHogs < MAX_HOGS; i++) {
+            hogParams[numHogs].kind = (hog_kind_t)k;
+            hogParams[numHogs].cacheBytes = cacheBytes;
+            pthread_create(&hogThreads[numHogs], NULL, hog,
+                           &hogParams[numHogs]);
+            numHogs++;
+        }
+    }
+
+    pthread_attr_init(&attr);
+    pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+    pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+
+    for (i = 0; i < NUM_SERVICES; i++) {
+        services[i].id = i + 1;
+        services[i].abort = aborts[i];
+        services[i].sem = sems[i];
+        services[i].period = period_ns(i);
+        services[i].load = (uint64_t)loads[i] * NSEC_PER_USEC;
+        stats_init(&services[i].release);
+        stats_init(&services[i].wakeup);
+        sem_init(sems[i], 0, 0);
+
+        param.sched_priority = maxPrio - 1 - i;
+        pthread_attr_setschedparam(&attr, &param);
+        rc = pthread_create(&serviceThreads[i], &attr, dummy_service,
+                            &services[i]);
+        if (rc != 0) {
+            printf("ERROR: can not create SCHED_FIFO threads. "
+                   "Did you run with sudo?\n");
+            exit(-1);
+        }
+    }
+
+    printf("jitter-bench: %llu periods, %s releases, hogs cpu=%u mem=%u "
+           "cache=%u io=%u\n", periods,
+           (seqParams.sleep == sequencer_absolute) ? "absolute" : "relative",
+           hogs[hog_cpu], hogs[hog_memory], hogs[hog_cache], hogs[hog_io]);
+
+    seqParams.sequencePeriods = periods;
+    param.sched_priority = maxPrio;
+    pthread_attr_setschedparam(&attr, &param);
+    pthread_create(&seqThread, &attr, sequencer, &seqParams);
+
+    pthread_join(seqThread, NULL);
+    for (i = 0; i < NUM_SERVICES; i++) {
+        pthread_join(serviceThreads[i], NULL);
+    }
+
+    stopHogs = true;
+    for (i = 0; i < numHogs; i++) {
+        pthread_join(hogThreads[i], NULL);
+    }
+
+    for (i = 0; i < NUM_SERVICES; i++) {
+        printf("Service_%u period %.3f ms load %.3f ms\n", services[i].id,
+               (double)services[i].period / NANOSEC_PER_SEC * 1000.0,
+               (double)services[i].load / NANOSEC_PER_SEC * 1000.0);
+        print_stats("release", &services[i].release);
+        print_stats("wakeup", &services[i].wakeup);
+    }
+
+    if (histogramFile) {
+        write_histogram(histogramFile, services);
+    }
+
+    return 0;
+}
@@ -0,0 +1,523 @@
+
+/*
+** Copyright 2018 Benjamin J. Andre.
+** All Rights Reserved.
+**
+** This Source Code Form is subject to the terms of the Mozilla
+** Public License, v. 2.0. If a copy of the MPL was not distributed
+** with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*/
+
+// Microbenchmarks for the vision and game kernels of the services.
+//
+// Every kernel Service_1, Service_2 and Service_3 run per job is timed in
+// isolation at 320x240, 640x480 and 1280x720, with the same parameters the
+// services use. Input frames come from a stored video or image sequence
+// (-f, anything VideoCapture opens) scaled to each resolution, or from
+// synthetic frames with moving laser dots. Each kernel runs over the frames
+// in turn and the mean and variance of its ns/pixel are reported, so every
+// optimization can be checked against a baseline run.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <getopt.h>
+#include <time.h>
+
+#include <string>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "bitmask.hpp"
+#include "constants.hpp"
+#include "gameobjects.hpp"
+#include "mjpeg.hpp"
+#include "overlay.hpp"
+
+using namespace cv;
+
+static const unsigned int MAX_FRAMES = 30u;
+static const unsigned int SYNTHETIC_FRAMES = 8u;
+static const unsigned int SYNTHETIC_LASERS = 2u;
+static const unsigned int WARMUP_ITERATIONS = 10u;
+
+// same parameters as the services
+static const double MOTION_THRESHOLD = 25.0;
+static const double RED_THRESHOLD = 170.0;
+static const double BACKGROUND_ALPHA = 0.1;
+static const int BLUR_SIZE = 5;
+static const double DISPLAY_SCALE = 2.5;
+static const int JPEG_QUALITY = 80;
+
+static const Size RESOLUTIONS[] = {
+    Size(320, 240),
+    Size(640, 480),
+    Size(1280, 720),
+};
+static const unsigned int NUM_RESOLUTIONS =
+    sizeof(RESOLUTIONS) / sizeof(RESOLUTIONS[0]);
+
+// inputs of every stage for one frame, computed once per resolution so the
+// timed kernels see the same data they would in the pipeline
+typedef struct {
+    Mat bgr;
+    Mat red;
+    Mat background;
+    Mat motion;
+    Mat lasers;
+    bitmask_t redBits;          /*!< red and motion masks, packed */
+    bitmask_t motionBits;
+    std::vector<uchar> jpeg;    /*!< bgr as a camera would send it */
+} frame_inputs_t;
+
+typedef struct {
+    std::vector<frame_inputs_t> frames;
+    const frame_inputs_t *in;
+
+    // outputs, reused across iterations like the services' scratch buffers
+    Mat channels[3];
+    Mat acc;
+    Mat accScaled;
+    Mat diff;
+    Mat mask;
+    Mat blurred;
+    Mat contourInput;
+    Mat display;
+    Mat canvas;
+    Mat decoded;
+    MjpegDecoder decoder;
+    bitmask_t packed;
+    bitmask_t packedBlurred;
+    std::vector<uint64_t> medianScratch;
+    std::vector<std::vector<Point> > contours;
+    std::vector<Vec4i> hierarchy;
+
+    Goal goal;
+    Obstacle obstacle;
+    Player player;
+    Vector<GameObj *> objects;
+    SpriteAtlas atlas;
+    int collisions;
+} bench_state_t;
+
+typedef struct {
+    const char *name;
+    void (*prepare)(bench_state_t &s);
+    void (*run)(bench_state_t &s);
+} kernel_t;
+
+static void prepare_none(bench_state_t &s)
+{
+    (void)s;
+}
+
+static void prepare_contours(bench_state_t &s)
+{
+    // findContours modifies its input
+    s.in->lasers.copyTo(s.contourInput);
+}
+
+static void prepare_canvas(bench_state_t &s)
+{
+    s.in->bgr.copyTo(s.canvas);
+}
+
+static void run_split(bench_state_t &s)
+{
+    split(s.in->bgr, s.channels);
+}
+
+static void run_convert_scale_abs(bench_state_t &s)
+{
+    convertScaleAbs(s.in->background, s.accScaled);
+}
+
+static void run_absdiff(bench_state_t &s)
+{
+    absdiff(s.in->red, s.accScaled, s.diff);
+}
+
+static void run_threshold(bench_state_t &s)
+{
+    threshold(s.in->red, s.mask, MOTION_THRESHOLD, 255, THRESH_BINARY);
+}
+
+static void run_accumulate_weighted(bench_state_t &s)
+{
+    accumulateWeighted(s.in->red, s.acc, BACKGROUND_ALPHA);
+}
+
+static void run_median_blur(bench_state_t &s)
+{
+    medianBlur(s.in->motion, s.blurred, BLUR_SIZE);
+}
+
+static void run_bitwise_and(bench_state_t &s)
+{
+    bitwise_and(s.in->motion, s.in->red, s.mask);
+}
+
+static void run_pack_threshold(bench_state_t &s)
+{
+    bitmask_threshold(s.in->red, (uint8_t)RED_THRESHOLD, 1, &s.packed);
+}
+
+static void run_bitmask_median5(bench_state_t &s)
+{
+    bitmask_median5(&s.in->motionBits, &s.packedBlurred, s.medianScratch);
+}
+
+static void run_bitmask_and(bench_state_t &s)
+{
+    bitmask_and(&s.in->motionBits, &s.in->redBits, &s.packed);
+}
+
+static void run_bitmask_unpack(bench_state_t &s)
+{
+    bitmask_unpack(&s.in->motionBits, s.mask);
+}
+
+static void run_find_contours(bench_state_t &s)
+{
+    findContours(s.contourInput, s.contours, s.hierarchy, CV_RETR_CCOMP,
+                 CV_CHAIN_APPROX_SIMPLE);
+}
+
+static void run_resize_half(bench_state_t &s)
+{
+    resize(s.in->motion, s.blurred, Size(), 0.5, 0.5, INTER_NEAREST);
+}
+
+static void run_resize_display(bench_state_t &s)
+{
+    resize(s.in->bgr, s.display, Size(), DISPLAY_SCALE, DISPLAY_SCALE);
+}
+
+static void run_draw_all(bench_state_t &s)
+{
+    draw_all(s.canvas, s.objects);
+}
+
+static void run_draw_sprites(bench_state_t &s)
+{
+    draw_goals(s.canvas, &s.goal, 1, s.atlas);
+    draw_obstacles(s.canvas, &s.obstacle, 1, s.atlas);
+    draw_players(s.canvas, &s.player, 1, s.atlas);
+}
+
+// what VideoCapture does with an MJPEG camera, full decode then split
+static void run_imdecode_split(bench_state_t &s)
+{
+    s.decoded = imdecode(s.in->jpeg, 1);
+    split(s.decoded, s.channels);
+}
+
+static void decode_scaled(bench_state_t &s, int denom)
+{
+    s.decoder.decode(&s.in->jpeg[0], s.in->jpeg.size(),
+                     Size(s.in->bgr.cols / denom, s.in->bgr.rows / denom),
+                     s.decoded);
+}
+
+static void run_mjpeg_full(bench_state_t &s)
+{
+    decode_scaled(s, 1);
+}
+
+static void run_mjpeg_half(bench_state_t &s)
+{
+    decode_scaled(s, 2);
+}
+
+static void run_mjpeg_quarter(bench_state_t &s)
+{
+    decode_scaled(s, 4);
+}
+
+static void run_detect_collision(bench_state_t &s)
+{
+    s.collisions += detect_collision(s.goal, s.player);
+    s.collisions += detect_collision(s.obstacle, s.player);
+}
+
+static const kernel_t KERNELS[] = {
+    {"split", prepare_none, run_split},
+    {"convertScaleAbs", prepare_none, run_convert_scale_abs},
+    {"absdiff", prepare_none, run_absdiff},
+    {"threshold", prepare_none, run_threshold},
+    {"accumulateWeighted", prepare_none, run_accumulate_weighted},
+    {"medianBlur", prepare_none, run_median_blur},
+    {"bitwise_and", prepare_none, run_bitwise_and},
+    {"findContours", prepare_contours, run_find_contours},
+    {"pack_threshold", prepare_none, run_pack_threshold},
+    {"bitmask_median5", prepare_none, run_bitmask_median5},
+    {"bitmask_and", prepare_none, run_bitmask_and},
+    {"bitmask_unpack", prepare_none, run_bitmask_unpack},
+    {"resize_half", prepare_none, run_resize_half},
+    {"resize_display", prepare_none, run_resize_display},
+    {"draw_all", prepare_canvas, run_draw_all},
+    {"draw_sprites", prepare_canvas, run_draw_sprites},
+    {"detect_collision", prepare_none, run_detect_collision},
+    {"imdecode_split", prepare_none, run_imdecode_split},
+    {"mjpeg_full", prepare_none, run_mjpeg_full},
+    {"mjpeg_half", prepare_none, run_mjpeg_half},
+    {"mjpeg_quarter", prepare_none, run_mjpeg_quarter},
+};
+static const unsigned int NUM_KERNELS = sizeof(KERNELS) / sizeof(KERNELS[0]);
+
+static uint64_t now_ns(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * NANOSEC_PER_SEC + (uint64_t)t.tv_nsec;
+}
+
+// noisy background with a few red dots that move a little every frame
+static void synthetic_frames(std::vector<Mat> &frames)
+{
+    Size size = RESOLUTIONS[NUM_RESOLUTIONS - 1];
+    unsigned int f, l;
+
+    for (f = 0; f < SYNTHETIC_FRAMES; f++) {
+        Mat frame(size, CV_8UC3);
+        randu(frame, Scalar(0, 0, 0), Scalar(96, 96, 96));
+
+        for (l = 0; l < SYNTHETIC_LASERS; l++) {
+            Point center(size.width * (l + 1) / (SYNTHETIC_LASERS + 1) +
+                         (int)(f * 8), size.height / 2 + (int)(f * 4 * l));
+            circle(frame, center, 6, Scalar(60, 60, 255), -1, 8, 0);
+        }
+        frames.push_back(frame);
+    }
+}
+
+static int stored_frames(const char *source, std::vector<Mat> &frames)
+{
+    VideoCapture cap(source);
+    Mat frame;
+
+    if (!cap.isOpened()) {
+        return -1;
+    }
+
+    while (frames.size() < MAX_FRAMES && cap.read(frame) && !frame.empty()) {
+        frames.push_back(frame.clone());
+    }
+
+    return frames.empty() ? -1 : 0;
+}
+
+static void build_inputs(const std::vector<Mat> &source, Size size,
+                         bench_state_t &s)
+{
+    Mat channels[3], acc, redMask;
+    std::vector<int> jpegParams;
+    unsigned int i;
+
+    jpegParams.push_back(CV_IMWRITE_JPEG_QUALITY);
+    jpegParams.push_back(JPEG_QUALITY);
+
+    s.frames.clear();
+    for (i = 0; i < source.size(); i++) {
+        frame_inputs_t in;
+
+        resize(source[i], in.bgr, size, 0, 0, INTER_AREA);
+        imencode(".jpg", in.bgr, in.jpeg, jpegParams);
+        split(in.bgr, channels);
+        in.red = channels[2].clone();
+
+        if (acc.empty()) {
+            in.red.convertTo(acc, CV_32FC1);
+        }
+        in.background = acc.clone();
+
+        convertScaleAbs(acc, channels[0]);
+        absdiff(in.red, channels[0], in.motion);
+        threshold(in.motion, in.motion, MOTION_THRESHOLD, 255, THRESH_BINARY);
+        accumulateWeighted(in.red, acc, BACKGROUND_ALPHA);
+
+        threshold(in.red, redMask, RED_THRESHOLD, 255, THRESH_BINARY);
+        bitwise_and(in.motion, redMask, in.lasers);
+        bitmask_threshold(in.red, (uint8_t)RED_THRESHOLD, 1, &in.redBits);
+        bitmask_threshold(in.motion, 0, 1, &in.motionBits);
+
+        s.frames.push_back(in);
+    }
+
+    s.acc = s.frames[0].background.clone();
+    s.in = &s.frames[0];
+    convertScaleAbs(s.acc, s.accScaled);
+
+    s.goal = Goal(Point(size.width / 3, size.height / 3), 15);
+    s.obstacle = Obstacle(Point(size.width / 2, size.height / 2), 12,
+                          Point(1, 1));
+    s.player = Player(Point(size.width / 3 + 10, size.height / 3), 10);
+    s.player.joined = true;
+
+    s.objects.clear();
+    s.objects.push_back(&s.goal);
+    s.objects.push_back(&s.obstacle);
+    s.objects.push_back(&s.player);
+
+    s.goal.prepare(s.atlas);
+    s.obstacle.prepare(s.atlas);
+    s.player.prepare(s.atlas);
+    s.collisions = 0;
+}
+
+// Welford's running mean and variance of ns/pixel
+typedef struct {
+    unsigned long long n;
+    double mean;
+    double m2;
+    double min;
+    double max;
+} running_stats_t;
+
+static void stats_add(running_stats_t *stats, double x)
+{
+    double delta = x - stats->mean;
+
+    stats->n++;
+    stats->mean += delta / stats->n;
+    stats->m2 += delta * (x - stats->mean);
+    if (stats->n == 1 || x < stats->min) {
+        stats->min = x;
+    }
+    if (stats->n == 1 || x > stats->max) {
+        stats->max = x;
+    }
+}
+
+static double stats_variance(const running_stats_t *stats)
+{
+    return (stats->n > 1) ? stats->m2 / (stats->n - 1) : 0.0;
+}
+
+static running_stats_t bench_kernel(const kernel_t *kernel, bench_state_t &s,
+                                    unsigned int iterations)
+{
+    running_stats_t stats;
+    double pixels = (double)s.frames[0].bgr.total();
+    unsigned int i;
+
+    memset(&stats, 0, sizeof(stats));
+
+    for (i = 0; i < WARMUP_ITERATIONS + iterations; i++) {
+        s.in = &s.frames[i % s.frames.size()];
+        kernel->prepare(s);
+
+        uint64_t start = now_ns();
+        kernel->run(s);
+        uint64_t elapsed = now_ns() - start;
+
+        if (i >= WARMUP_ITERATIONS) {
+            stats_add(&stats, (double)elapsed / pixels);
+        }
+    }
+
+    return stats;
+}
+
+static void usage(const char *name)
+{
+    printf("usage: %s [-f frames] [-n iterations] [-o results.csv]\n", name);
+    printf("  -f  stored frames, a video file or image sequence pattern\n");
+    printf("      (default synthetic frames)\n");
+    printf("  -n  timed iterations per kernel and resolution (default 200)\n");
+    printf("  -o  also write the results as csv\n");
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<Mat> source;
+    bench_state_t state;
+    const char *frameSource = NULL;
+    const char *csvFile = NULL;
+    unsigned int iterations = 200;
+    unsigned int r, k;
+    FILE *csv = NULL;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "f:n:o:h")) != -1) {
+        switch (opt) {
+        case 'f':
+            frameSource = optarg;
+            break;
+        case 'n':
+            iterations = atoi(optarg);
+            break;
+        case 'o':
+            csvFile = optarg;
+            break;
+        case 'h':
+            usage(argv[0]);
+            exit(0);
+        default:
+            usage(argv[0]);
+            exit(-1);
+        }
+    }
+
+    if (iterations == 0) {
+        usage(argv[0]);
+        exit(-1);
+    }
+
+    if (frameSource) {
+        if (stored_frames(frameSource, source) < 0) {
+            printf("ERROR: can not read frames from %s\n", frameSource);
+            exit(-1);
+        }
+    } else {
+        synthetic_frames(source);
+    }
+    printf("%u frames from %s, %u iterations\n", (unsigned int)source.size(),
+           frameSource ? frameSource : "synthetic source", iterations);
+
+    if (csvFile) {
+        csv = fopen(csvFile, "w");
+        if (!csv) {
+            perror(csvFile);
+            exit(-1);
+        }
+        fprintf(csv, "kernel, width, height, ns_per_pixel, variance, "
+                "min, max, ns_per_call\n");
+    }
+
+    for (r = 0; r < NUM_RESOLUTIONS; r++) {
+        Size size = RESOLUTIONS[r];
+        double pixels = (double)size.area();
+
+        build_inputs(source, size, state);
+
+        printf("\n%dx%d\n", size.width, size.height);
+        printf("%-20s %12s %12s %12s %12s %14s\n", "kernel", "ns/pixel",
+               "variance", "min", "max", "ns/call");
+
+        for (k = 0; k < NUM_KERNELS; k++) {
+            running_stats_t stats = bench_kernel(&KERNELS[k], state,
+                                                 iterations);
+
+            printf("%-20s %12.4f %12.4g %12.4f %12.4f %14.0f\n",
+                   KERNELS[k].name, stats.mean, stats_variance(&stats),
+                   stats.min, stats.max, stats.mean * pixels);
+            if (csv) {
+                fprintf(csv, "%s, %d, %d, %.6f, %.6g, %.6f, %.6f, %.0f\n",
+                        KERNELS[k].name, size.width, size.height, stats.mean,
+                        stats_variance(&stats), stats.min, stats.max,
+                        stats.mean * pixels);
+            }
+        }
+    }
+
+    if (csv) {
+        fclose(csv);
+    }
+
+    return 0;
+}
@@ -84,6 +84,7 @@
 #include <cstdbool>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <unistd.h>
 
 #include <iostream>
@@ -98,10 +99,21 @@
 #include <sys/sysinfo.h>
 
 #include <errno.h>
+#include <getopt.h>
+#include <limits.h>
 
 #include <opencv2/opencv.hpp>
 #include "gameutil.hpp"
 #include "gameobjects.hpp"
+#include "tracker.hpp"
+#include "overload.hpp"
+#include "warmup.hpp"
+#include "perfctr.hpp"
+#include "telemetry.hpp"
+#include "evlog.hpp"
+#include "executor.hpp"
+#include "frame_source.hpp"
+#include "pipeline.hpp"
 
 using namespace cv;
 
@@ -114,63 +126,427 @@ using namespace cv;
 
 #include "plog.hpp"
 
-#define NUM_WORK_THREADS (3)
-#define NUM_THREADS (NUM_WORK_THREADS + 1)
+// the sequencer and the services of every pipeline
+#define MAX_THREADS (1 + NUM_SERVICES * MAX_PIPELINES)
 
-static const int MAX_MSG_LEN = 1024;
-static const bool debug = false;
-static const unsigned int VIDEO_WIDTH = 320;
-static const unsigned int VIDEO_HEIGHT = 240;
-
-extern int abortS1;
-extern sem_t semS1;
-extern int abortS2;
-extern sem_t semS2;
-extern int abortS3;
-extern sem_t semS3;
 extern struct timeval start_time_val;
+extern telemetry_t *telemetry;
+
+static const char *traceFile = "results.csv";
+
+// recorded frames replayed instead of the camera, for a repeatable workload
+static const char *replayFile = NULL;
+static const unsigned int REPLAY_SEED = 5623;
+
+// messages of the RT threads, syslog unless a file is given
+static const char *logFile = NULL;
+
+// Unix socket the rendered frames are streamed on, none unless given
+static const char *spectatorSocket = NULL;
+
+// file the camera and rendered frames are saved to, none unless given
+static const char *archiveFile = NULL;
+static archive_format_t archiveFormat = archive_raw;
+
+// best effort work of every pipeline, released by the sequencer to a pool
+// of workers instead of a thread each
+static executor_t executor;
+static executor_job_t jobs[2 * MAX_PIPELINES];
+
+// one pipeline per camera, all released by the one sequencer
+static pipeline_t pipelines[MAX_PIPELINES];
+static release_group_t groups[MAX_PIPELINES];
+
+// posted by each service once it has initialized and warmed up, and by
+// each renderer once its first frame is on screen
+static sem_t semReady;
+static sem_t semShown;
+
+// how long startup waits for the first frames before giving up on the
+// report, the game itself keeps running
+static const unsigned int FIRST_FRAME_TIMEOUT_SEC = 10u;
+
+// locked and prefaulted before any service starts
+static const size_t WARMUP_HEAP_BYTES = 64u * 1024u * 1024u;
+
+static void *(*const SERVICES[NUM_SERVICES])(void *) = {
+    Service_1, Service_2, Service_3
+};
+
+static void usage(const char *name)
+{
+    printf("usage: %s [-a] [-A archive] [-c cameras] [-d deadline_params.csv] "
+           "[-l log] [-L msec] [-n periods] [-p] [-r video] [-s] [-S socket] "
+           "[-t trace.csv] [-w workers] [-z]\n",
+           name);
+    printf("  -a  release on an absolute time grid instead of relative sleeps\n");
+    printf("  -A  save the camera and rendered frames to this file,\n");
+    printf("      pipeline p > 0 to archive.p\n");
+    printf("  -c  cameras, each with its own pipeline (default 1, max %u)\n",
+           MAX_PIPELINES);
+    printf("  -d  run the threads listed in the file under SCHED_DEADLINE\n");
+    printf("  -l  write the RT thread messages to this file instead of syslog\n");
+    printf("  -L  display latency the players are predicted ahead by "
+           "(default %u)\n", (unsigned int)(DISPLAY_LATENCY_NSEC / 1000000u));
+    printf("  -n  sequencer periods to run (default 9000, 5 minutes)\n");
+    printf("  -p  record performance counters with every plog entry\n");
+    printf("  -r  replay recorded frames in a loop instead of the camera,\n");
+    printf("      .mjpeg files are decoded at reduced scale\n");
+    printf("  -s  generate synthetic frames instead of the camera\n");
+    printf("  -S  stream the rendered frames to spectators on this Unix\n");
+    printf("      socket, pipeline p > 0 on socket.p\n");
+    printf("  -t  append the plog trace to this file (default results.csv)\n");
+    printf("  -w  best effort worker threads (default %u, max %u)\n",
+           EXECUTOR_DEFAULT_WORKERS, EXECUTOR_MAX_WORKERS);
+    printf("  -z  PNG encode the archived frames instead of saving them raw\n");
+}
+
+// cores the services of pipeline p are restricted to, an equal share of
+// the online cores so a busy pipeline cannot delay the others. With more
+// pipelines than cores they share round robin.
+static void partition_cpus(unsigned int p, unsigned int numPipelines,
+                           cpu_set_t *cpus)
+{
+    unsigned int n = (unsigned int)get_nprocs();
+    unsigned int c;
+
+    CPU_ZERO(cpus);
+
+    if (numPipelines > n) {
+        CPU_SET(p % n, cpus);
+        return;
+    }
+
+    for (c = p * n / numPipelines; c < (p + 1) * n / numPipelines; c++) {
+        CPU_SET(c, cpus);
+    }
+}
+
+// cores no pipeline's services are restricted to, or the last online core
+// when the services may run anywhere
+static void background_cpus(unsigned int numPipelines, cpu_set_t *cpus)
+{
+    unsigned int n = (unsigned int)get_nprocs();
+    unsigned int p, c;
+
+    CPU_ZERO(cpus);
+    for (c = 0; c < n; c++) {
+        CPU_SET(c, cpus);
+    }
+    for (p = 0; p < numPipelines; p++) {
+        for (c = 0; c < n && pipelines[p].pinned; c++) {
+            if (CPU_ISSET(c, &pipelines[p].cpus)) {
+                CPU_CLR(c, cpus);
+            }
+        }
+    }
 
-Mat src, rsrc, acc, accScaled, sub;
+    if (CPU_COUNT(cpus) == 0) {
+        CPU_SET(n - 1, cpus);
+    }
+}
 
-Player player(Point(VIDEO_WIDTH,VIDEO_HEIGHT), 10);    
-Goal goal(Point(200, 200) , 15);
+// throughput and release to start delay of each kind of best effort job
+static void report_executor(const executor_t *ex)
+{
+    double sec = (double)(ex->stopped - ex->started) / 1e9;
+    unsigned int i;
+
+    for (i = 0; i < ex->numTypes; i++) {
+        const executor_stats_t *st = &ex->types[i];
+
+        if (st->released == 0) {
+            continue;
+        }
+        printf("%s jobs: %llu run, %.1f/s, delay mean %.2f ms max %.2f ms, "
+               "run mean %.2f ms max %.2f ms, %llu stolen, %llu skipped, "
+               "%llu rejected\n",
+               st->name, st->completed,
+               (sec > 0.0) ? (double)st->completed / sec : 0.0,
+               (st->completed > 0) ?
+               (double)st->delayTotal / st->completed / 1e6 : 0.0,
+               (double)st->delayMax / 1e6,
+               (st->completed > 0) ?
+               (double)st->runTotal / st->completed / 1e6 : 0.0,
+               (double)st->runMax / 1e6, st->stolen, st->skipped,
+               st->rejected);
+    }
+}
 
-static const unsigned int NUM_OBS = 1;
-Obstacle obstacles[NUM_OBS];
+static double msec_since(uint64_t from, uint64_t to)
+{
+    return (double)(to - from) / 1e6;
+}
 
-int score = 0;
-bool goalCollision = false, gameOver = false, isPaused = false;
+// time from launch until each pipeline's services were ready and its first
+// frame was displayed. Operators restart sessions often, so this is what
+// they wait for every time.
+static void report_startup(uint64_t launched, unsigned int numPipelines)
+{
+    struct timespec deadline;
+    unsigned int p, s, shown = 0;
+
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += FIRST_FRAME_TIMEOUT_SEC;
+    while (shown < numPipelines) {
+        if (sem_timedwait(&semShown, &deadline) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        shown++;
+    }
 
-plog_buffer_t buff;
+    for (p = 0; p < numPipelines; p++) {
+        const pipeline_t *pl = &pipelines[p];
+        uint64_t shownTime = __atomic_load_n(&pl->shownTime, __ATOMIC_ACQUIRE);
+        unsigned int slowest = 0;
 
-void *Service_1(void *threadp);
-void *Service_2(void *threadp);
-void *Service_3(void *threadp);
+        for (s = 1; s < NUM_SERVICES; s++) {
+            if (pl->readyTime[s] > pl->readyTime[slowest]) {
+                slowest = s;
+            }
+        }
 
+        if (shownTime) {
+            printf("%s: first frame after %.1f ms, ready after %.1f ms "
+                   "(slowest %s)\n", pl->window,
+                   msec_since(launched, shownTime),
+                   msec_since(launched, pl->readyTime[slowest]),
+                   pl->names[slowest]);
+            syslog(LOG_INFO, "%s time to first frame %.1f ms\n", pl->window,
+                   msec_since(launched, shownTime));
+        } else {
+            printf("%s: no frame within %u s, ready after %.1f ms "
+                   "(slowest %s)\n", pl->window, FIRST_FRAME_TIMEOUT_SEC,
+                   msec_since(launched, pl->readyTime[slowest]),
+                   pl->names[slowest]);
+        }
+    }
+}
 
 int main(int argc, char **argv)
 {
+    // time to first frame is measured from here
+    uint64_t launched = telemetry_now();
+
     struct timeval current_time_val;
     int rc, scope;
     cpu_set_t threadcpu;
-    pthread_t threads[NUM_THREADS];
-    threadParams_t threadParams[NUM_THREADS];
-    pthread_attr_t rt_sched_attr[NUM_THREADS];
+    pthread_t threads[MAX_THREADS];
+    threadParams_t threadParams[MAX_THREADS];
+    pthread_attr_t rt_sched_attr[MAX_THREADS];
     int rt_max_prio, rt_min_prio;
-    struct sched_param rt_param[NUM_THREADS];
+    struct sched_param rt_param[MAX_THREADS];
     struct sched_param main_param;
     pthread_attr_t main_attr;
     pid_t mainpid;
     cpu_set_t allcpuset;
+    // indexed by plog id, like the parameter file
+    deadline_params_t deadlineParams[MAX_THREAD_PLOG_IDS];
+    const char *deadlineFile = NULL;
+    sequencer_sleep_t sequencerSleep = sequencer_relative;
+    unsigned long long sequencePeriods = 9000;
+    uint64_t displayLatency = DISPLAY_LATENCY_NSEC;
+    unsigned int numPipelines = 1, numThreads, numStarted = 0;
+    unsigned int numWorkers = EXECUTOR_DEFAULT_WORKERS, numJobs = 0;
+    int archiveType, spectatorType;
+    cpu_set_t workerCpus;
+    unsigned int p, s, t;
+    bool synthetic = false;
+    int opt;
+    fault_count_t startFaults, warmFaults, endFaults, delta;
+
+    get_process_faults(&startFaults);
+
+    while ((opt = getopt(argc, argv, "aA:c:d:l:L:n:pr:sS:t:w:zh")) != -1) {
+        switch (opt) {
+        case 'a':
+            sequencerSleep = sequencer_absolute;
+            break;
+        case 'A':
+            archiveFile = optarg;
+            break;
+        case 'c':
+            numPipelines = (unsigned int)strtoul(optarg, NULL, 10);
+            break;
+        case 'd':
+            deadlineFile = optarg;
+            break;
+        case 'l':
+            logFile = optarg;
+            break;
+        case 'L':
+            displayLatency = strtoull(optarg, NULL, 10) * 1000000u;
+            break;
+        case 'n':
+            sequencePeriods = strtoull(optarg, NULL, 10);
+            break;
+        case 'p':
+            perfctr_enable();
+            break;
+        case 'r':
+            replayFile = optarg;
+            break;
+        case 's':
+            synthetic = true;
+            break;
+        case 'S':
+            spectatorSocket = optarg;
+            break;
+        case 't':
+            traceFile = optarg;
+            break;
+        case 'w':
+            numWorkers = (unsigned int)strtoul(optarg, NULL, 10);
+            break;
+        case 'z':
+            archiveFormat = archive_png;
+            break;
+        case 'h':
+            usage(argv[0]);
+            exit(0);
+        default:
+            usage(argv[0]);
+            exit(-1);
+        }
+    }
 
-    //init things needed in services
-    initPlogBuff(10000, &buff);
+    if (numPipelines < 1 || numPipelines > MAX_PIPELINES ||
+            numWorkers < 1 || numWorkers > EXECUTOR_MAX_WORKERS) {
+        usage(argv[0]);
+        exit(-1);
+    }
+    numThreads = 1 + NUM_SERVICES * numPipelines;
+
+    memset(deadlineParams, 0, sizeof(deadlineParams));
+    if (deadlineFile) {
+        rc = read_deadline_params(deadlineFile, deadlineParams,
+                                  MAX_THREAD_PLOG_IDS);
+        if (rc < 0) {
+            perror("read_deadline_params");
+            exit(-1);
+        }
+        printf("SCHED_DEADLINE configured for %d threads\n", rc);
+    }
 
-    unsigned int i;
-    for(i = 0; i < NUM_OBS; i++)
-    {
-        obstacles[i].speed = Point(rand()%7 - 3, rand()%7 - 3);
-        obstacles[i].size = rand()%10 + 5;
+    // lock everything before the services allocate their buffers
+    if (lock_memory() < 0) {
+        perror("mlockall");
+    }
+    prefault_heap(WARMUP_HEAP_BYTES);
+    prefault_stack(WARMUP_STACK_BYTES);
+
+    // live counters for telemetry-top, the RT threads only write memory
+    telemetry = telemetry_create();
+    if (!telemetry) {
+        perror("telemetry_create");
+    }
+    telemetry_watch(telemetry, 0, SEQUENCER_PERIOD_NSEC);
+
+    // the RT threads only queue messages, this thread formats them
+    if (evlog_start(logFile) < 0) {
+        perror("evlog_start");
+    }
+
+    // same obstacle course every replay
+    if (replayFile || synthetic) {
+        srand(REPLAY_SEED);
+    }
+
+    if (sem_init (&semReady, 0, 0) || sem_init(&semShown, 0, 0)) {
+        printf ("Failed to initialize ready semaphore\n");
+        exit (-1);
+    }
+
+    // only the first pipeline is published to telemetry-top
+    for (p = 0; p < numPipelines; p++) {
+        frame_source_config_t source;
+
+        source.kind = source_camera;
+        if (synthetic) {
+            source.kind = source_synthetic;
+        } else if (mjpeg_file(replayFile)) {
+            source.kind = source_mjpeg;
+        } else if (replayFile) {
+            source.kind = source_replay;
+        }
+        source.index = (numPipelines > 1 || synthetic) ? (int)p : -1;
+        source.file = replayFile;
+        source.once = false;
+        source.size = Size(VIDEO_WIDTH, VIDEO_HEIGHT);
+
+        if (pipeline_init(&pipelines[p], p, source,
+                          (p == 0) ? telemetry : NULL, &semReady,
+                          &semShown) < 0) {
+            perror("pipeline_init");
+            exit(-1);
+        }
+
+        pipelines[p].fullscreen = (numPipelines == 1);
+        pipelines[p].displayLatency = displayLatency;
+        // SCHED_DEADLINE refuses threads whose affinity is restricted, so
+        // in deadline mode every pipeline shares every core
+        if (numPipelines > 1 && deadlineFile == NULL) {
+            partition_cpus(p, numPipelines, &pipelines[p].cpus);
+            pipelines[p].pinned = true;
+        }
+        groups[p] = pipelines[p].group;
+
+        if (spectatorSocket) {
+            char path[PATH_MAX];
+
+            if (p == 0) {
+                snprintf(path, sizeof(path), "%s", spectatorSocket);
+            } else {
+                snprintf(path, sizeof(path), "%s.%u", spectatorSocket, p);
+            }
+            if (spectator_start(&pipelines[p].spectator, path,
+                                Size(VIDEO_WIDTH, VIDEO_HEIGHT)) < 0) {
+                perror("spectator_start");
+            }
+        }
+
+        if (archiveFile) {
+            char path[PATH_MAX];
+
+            if (p == 0) {
+                snprintf(path, sizeof(path), "%s", archiveFile);
+            } else {
+                snprintf(path, sizeof(path), "%s.%u", archiveFile, p);
+            }
+            if (archive_start(&pipelines[p].archive, path, archiveFormat,
+                              Size(VIDEO_WIDTH, VIDEO_HEIGHT)) < 0) {
+                perror(path);
+            }
+        }
+    }
+
+    // the workers are SCHED_OTHER, on cores the services share they only
+    // get the time the services leave idle
+    executor_init(&executor);
+    archiveType = executor_type(&executor, "archive");
+    spectatorType = executor_type(&executor, "spectator");
+    for (p = 0; p < numPipelines; p++) {
+        if (pipelines[p].archive.running) {
+            executor_job_init(&jobs[numJobs++], archiveType,
+                              ARCHIVE_FLUSH_PERIOD, archive_flush,
+                              &pipelines[p].archive);
+        }
+        if (pipelines[p].spectator.running) {
+            executor_job_init(&jobs[numJobs++], spectatorType,
+                              SPECTATOR_STREAM_PERIOD, spectator_stream,
+                              &pipelines[p].spectator);
+        }
+    }
+    background_cpus(numPipelines, &workerCpus);
+    for (p = 0; p < numPipelines; p++) {
+        pipelines[p].captureCpus = workerCpus;
+    }
+    if (numJobs > 0 &&
+            executor_start(&executor, numWorkers, &workerCpus) < 0) {
+        perror("executor_start");
     }
 
     std::cout << "red laser pointer cursor game" << std::endl;
@@ -192,24 +568,6 @@ int main(int argc, char **argv)
 
     printf("Using CPUS=%d from total available.\n", CPU_COUNT(&allcpuset));
 
-
-    // initialize the sequencer semaphores
-    //
-    if (sem_init (&semS1, 0, 0)) {
-        printf ("Failed to initialize S1 semaphore\n");
-        exit (-1);
-    }
-
-    if (sem_init (&semS2, 0, 0)) {
-        printf ("Failed to initialize S1 semaphore\n");
-        exit (-1);
-    }
-
-    if (sem_init (&semS3, 0, 0)) {
-        printf ("Failed to initialize S1 semaphore\n");
-        exit (-1);
-    }
-
     mainpid = getpid();
 
     rt_max_prio = sched_get_priority_max(SCHED_FIFO);
@@ -238,7 +596,7 @@ int main(int argc, char **argv)
     printf("rt_max_prio=%d\n", rt_max_prio);
     printf("rt_min_prio=%d\n", rt_min_prio);
 
-    for (uint32_t i = 0; i < NUM_THREADS; i++) {
+    for (uint32_t i = 0; i < numThreads; i++) {
 
         CPU_ZERO(&threadcpu);
         CPU_SET(3, &threadcpu);
@@ -252,75 +610,84 @@ int main(int argc, char **argv)
         pthread_attr_setschedparam(&rt_sched_attr[i], &rt_param[i]);
 
         threadParams[i].threadIdx = i;
+        threadParams[i].sleep = sequencerSleep;
+        threadParams[i].traceFile = traceFile;
+        threadParams[i].groups = NULL;
+        threadParams[i].numGroups = 0;
+        threadParams[i].pipeline = NULL;
+        threadParams[i].executor = NULL;
+        threadParams[i].jobs = NULL;
+        threadParams[i].numJobs = 0;
     }
 
     printf("Service threads will run on %d CPU cores\n", CPU_COUNT(&threadcpu));
 
     // Create Service threads which will block awaiting release for:
     //
-
-    // Servcie_1 = RT_MAX-1 @ 3 Hz
+    // Service_1 = RT_MAX-1 @ 3 Hz
+    // Service_2 = RT_MAX-2 @ 1 Hz
+    // Service_3 = RT_MAX-3 @ 0.5 Hz
     //
-    rt_param[1].sched_priority = rt_max_prio - 1;
-    pthread_attr_setschedparam(&rt_sched_attr[1], &rt_param[1]);
-    rc = pthread_create(&threads[1],             // pointer to thread descriptor
-                        &rt_sched_attr[1],         // use specific attributes
-                        //(void *)0,               // default attributes
-                        Service_1,                 // thread function entry point
-                        (void *) & (threadParams[1]) // parameters to pass in
-                       );
-    if (rc < 0) {
-        perror("pthread_create for service 1");
-    } else {
-        printf("pthread_create successful for service 1\n");
+    // once per pipeline, each pipeline on its own share of the cores unless
+    // in deadline mode
+    for (p = 0; p < numPipelines; p++) {
+        for (s = 0; s < NUM_SERVICES; s++) {
+            t = 1 + p * NUM_SERVICES + s;
+
+            rt_param[t].sched_priority = rt_max_prio - 1 - s;
+            pthread_attr_setschedparam(&rt_sched_attr[t], &rt_param[t]);
+            if (pipelines[p].pinned) {
+                pthread_attr_setaffinity_np(&rt_sched_attr[t],
+                                            sizeof(cpu_set_t),
+                                            &pipelines[p].cpus);
+            }
+            threadParams[t].pipeline = &pipelines[p];
+            threadParams[t].deadline =
+                deadlineParams[pipeline_plog_id(&pipelines[p], s + 1)];
+
+            rc = pthread_create(&threads[t], &rt_sched_attr[t], SERVICES[s],
+                                (void *) & (threadParams[t]));
+            if (rc != 0) {
+                perror("pthread_create for service");
+            } else {
+                printf("pthread_create successful for %s\n",
+                       pipelines[p].names[s]);
+                numStarted++;
+            }
+        }
     }
 
 
-    // Servcie_1 = RT_MAX-1 @ 3 Hz
+    // Wait for service threads to initialize, run their warm-up jobs and
+    // await release by sequencer. The services of every pipeline open their
+    // camera, window and buffers at the same time, so this is as long as
+    // the slowest of them rather than the sum. Only services that were
+    // created post, e.g. none when SCHED_FIFO is refused without root.
     //
-    rt_param[2].sched_priority = rt_max_prio - 2;
-    pthread_attr_setschedparam(&rt_sched_attr[2], &rt_param[2]);
-    rc = pthread_create(&threads[2],             // pointer to thread descriptor
-                        &rt_sched_attr[2],         // use specific attributes
-                        //(void *)0,               // default attributes
-                        Service_2,                 // thread function entry point
-                        (void *) & (threadParams[2]) // parameters to pass in
-                       );
-    if (rc < 0) {
-        perror("pthread_create for service 2");
-    } else {
-        printf("pthread_create successful for service 2\n");
+    for (t = 0; t < numStarted; t++) {
+        sem_wait(&semReady);
     }
-
-
-    // Servcie_1 = RT_MAX-1 @ 3 Hz
-    //
-    rt_param[3].sched_priority = rt_max_prio - 3;
-    pthread_attr_setschedparam(&rt_sched_attr[3], &rt_param[3]);
-    rc = pthread_create(&threads[3],             // pointer to thread descriptor
-                        &rt_sched_attr[3],         // use specific attributes
-                        //(void *)0,               // default attributes
-                        Service_3,                 // thread function entry point
-                        (void *) & (threadParams[3]) // parameters to pass in
-                       );
-    if (rc < 0) {
-        perror("pthread_create for service 3");
-    } else {
-        printf("pthread_create successful for service 3\n");
+    if (numStarted < numThreads - 1) {
+        printf("%u of %u services failed to start\n",
+                numThreads - 1 - numStarted, numThreads - 1);
     }
 
-
-    // Wait for service threads to initialize and await release by sequencer.
-    //
-    // Note that the sleep is not necessary of RT service threads are created wtih
-    // correct POSIX SCHED_FIFO priorities compared to non-RT priority of this main
-    // program.
-    //
-    usleep(1000000);
+    get_process_faults(&warmFaults);
+    delta = fault_delta(&startFaults, &warmFaults);
+    printf("Warm-up page faults: minor=%ld major=%ld\n", delta.minor,
+           delta.major);
+    printf("Services ready after %.1f ms\n",
+           msec_since(launched, telemetry_now()));
 
     // Create Sequencer thread, which like a cyclic executive, is highest prio
     printf("Start sequencer\n");
-    threadParams[0].sequencePeriods = 9000;
+    threadParams[0].sequencePeriods = sequencePeriods;
+    threadParams[0].deadline = deadlineParams[0];
+    threadParams[0].groups = groups;
+    threadParams[0].numGroups = numPipelines;
+    threadParams[0].executor = &executor;
+    threadParams[0].jobs = jobs;
+    threadParams[0].numJobs = numJobs;
 
     // Sequencer = RT_MAX   @ 30 Hz
     //
@@ -332,299 +699,63 @@ int main(int argc, char **argv)
         perror("pthread_create for sequencer service 0");
     } else {
         printf("pthread_create successful for sequeencer service 0\n");
+        report_startup(launched, numPipelines);
     }
 
 
-    for (uint32_t i = 0; i < NUM_THREADS; i++) {
+    for (uint32_t i = 0; i < numThreads; i++) {
         pthread_join(threads[i], NULL);
     }
 
-    csvAppendPlogBuff(&buff, "results.csv");
-
-    printf("\nGame Over\n");
-}
-
-//frame grabbing and accumulating service
-void *Service_1(void *threadp)
-{
-    struct timeval current_time_val;
-    unsigned long long S1Cnt = 0;
-    plog_t *curr;
-
-    char message[MAX_MSG_LEN];
-
-    if (debug) {
-        gettimeofday(&current_time_val, (struct timezone *)0);
-        snprintf(message, MAX_MSG_LEN, "Frame Sampler thread @ sec=%d, msec=%d\n",
-                 (int)(current_time_val.tv_sec - start_time_val.tv_sec),
-                 (int)current_time_val.tv_usec / USEC_PER_MSEC);
-        printf("%s", message);
+    // the sequencer released its last jobs, let them finish
+    if (executor.running) {
+        executor_stop(&executor);
+        report_executor(&executor);
     }
 
-    VideoCapture cap;
-    Mat bgr[3];
-
-    init_camera(&cap, VIDEO_WIDTH, VIDEO_HEIGHT);
-
-    cap >> src;
-    split(src, bgr);
-    acc = Mat::zeros(bgr[2].size(), CV_32FC1);
-
-    while (!abortS1) {
-        sem_wait(&semS1);
-        getStartPlog(&buff, &curr, 1);
-        S1Cnt++;
-
-        cap >> src;
-
-        split(src, bgr);
-
-        bgr[2].copyTo(rsrc);
-
-        // Scale it to 8-bit unsigned
-        convertScaleAbs(acc, accScaled);
-
-        absdiff(rsrc, accScaled, sub);
-
-        threshold(sub, sub, 25, 255, THRESH_BINARY);
-
-        Scalar m = mean(sub);
-
-
-        //update the background model
-        accumulateWeighted(rsrc, acc, 0.1);
-
-        if(m.val[0] > 20)
-        {
-            isPaused = true;
-        }
-        else
-        {
-            isPaused = false;
-        }
-
-
-        if (debug) {
-            gettimeofday(&current_time_val, (struct timezone *)0);
-            snprintf(message, MAX_MSG_LEN, "Frame Sampler release %llu @ sec=%d, msec=%d\n",
-                     S1Cnt,
-                     (int)(current_time_val.tv_sec - start_time_val.tv_sec),
-                     (int)current_time_val.tv_usec / USEC_PER_MSEC);
-            printf("%s", message);
-        }
-
-        endPlog(curr);
-    }
-
-    pthread_exit((void *)0);
-}
-
-//laser tracking and collision detection service
-void *Service_2(void *threadp)
-{
-    struct timeval current_time_val;
-    unsigned long long S2Cnt = 0;
-    plog_t *curr;
-
-    char message[MAX_MSG_LEN];
-    
-    if (debug) {
-        gettimeofday(&current_time_val, (struct timezone *)0);
-        snprintf(message, MAX_MSG_LEN,
-                 "Tracking and collision detection thread @ sec=%d, msec=%d\n",
-                 (int)(current_time_val.tv_sec - start_time_val.tv_sec),
-                 (int)current_time_val.tv_usec / USEC_PER_MSEC);
-        printf("%s", message);
-    }
-
-    Mat ba;
-
-    while (!abortS2) {
-        sem_wait(&semS2);
-        getStartPlog(&buff, &curr, 2);
-        S2Cnt++;
-
-        threshold(rsrc, rsrc, 170, 255, THRESH_BINARY);
-
-        medianBlur(sub, sub, 5);
-        medianBlur(rsrc, rsrc, 5);
+    get_process_faults(&endFaults);
+    delta = fault_delta(&warmFaults, &endFaults);
+    printf("Steady state page faults: minor=%ld major=%ld\n", delta.minor,
+           delta.major);
 
-        bitwise_and(sub,rsrc,ba);
+    for (p = 0; p < numPipelines; p++) {
+        for (s = 0; s < NUM_SERVICES; s++) {
+            unsigned long long violations =
+                budget_violations(&pipelines[p].budgets[s]);
 
-        vector<vector<Point> > contours;
-        vector<Vec4i> hierarchy;
-
-        findContours( ba, contours, hierarchy,
-            CV_RETR_CCOMP, CV_CHAIN_APPROX_SIMPLE );
-
-        /// Approximate contour to polygon and get bounding circle
-        vector<vector<Point> > contours_poly( contours.size() );
-        vector<Point2f>center( contours.size() );
-        vector<float>radius( contours.size() );
-
-        if(!isPaused){
-            unsigned int i;
-
-            for(i = 0; i < contours.size(); i++)
-            {
-                approxPolyDP( Mat(contours[i]), contours_poly[i], 3, true );
-                minEnclosingCircle( (Mat)contours_poly[i], center[i], radius[i] );
-            }
-
-            if(center.size() > 0)
-            {
-                player.reposition(center[0]);
-            }
-
-
-            if(detect_collision(goal, player))
-            {
-                score++;
-                goal.pos = Point(rand()%VIDEO_WIDTH, rand()%VIDEO_HEIGHT);
-            }
-
-            for(i = 0; i < NUM_OBS; i++)
-            {
-                if(detect_collision(obstacles[i], player))
-                {
-                    gameOver = true;
-		    if (debug) {
-		      std::cout << "pre-move obstacle collision" << std::endl;
-		    }
-                }
-            }
-
-            for(i = 0; i < NUM_OBS; i++)
-            {
-                obstacles[i].move();
-
-                if((obstacles[i].pos.x > (signed)VIDEO_WIDTH) || (obstacles[i].pos.x < 0))
-                {
-                    obstacles[i].speed.x *= -1;
-                }
-
-                if((obstacles[i].pos.y > (signed)VIDEO_HEIGHT) || (obstacles[i].pos.y < 0))
-                {
-                    obstacles[i].speed.y *= -1;
-                }
-            }
-
-            for(i = 0; i < NUM_OBS; i++)
-            {
-                if(detect_collision(obstacles[i], player))
-                {
-                    gameOver = true;
-		    if (debug) {
-		      std::cout << "post-move obstacle collision" << std::endl;
-		    }
-                }
+            if (violations > 0) {
+                printf("%s overran its CPU budget in %llu jobs\n",
+                       pipelines[p].names[s], violations);
             }
-
-            if(gameOver)
-            {
-                // abortS1 = true;
-                // abortS2 = true;
-            }
-
         }
-
-        if (debug) {
-            gettimeofday(&current_time_val, (struct timezone *)0);
-            snprintf(message, MAX_MSG_LEN,
-                     "Tracking and collision detection release %llu @ sec=%d, msec=%d\n", S2Cnt,
-                     (int)(current_time_val.tv_sec - start_time_val.tv_sec),
-                     (int)current_time_val.tv_usec / USEC_PER_MSEC);
-            printf("%s", message);
+        csvAppendPlogBuff(&pipelines[p].trace, traceFile);
+
+        if (pipelines[p].spectator.running) {
+            spectator_stop(&pipelines[p].spectator);
+            printf("%s spectators: %llu frames, %llu skipped, %llu resyncs\n",
+                   pipelines[p].window, pipelines[p].spectator.published,
+                   pipelines[p].spectator.busy,
+                   pipelines[p].spectator.resyncs);
         }
 
-        endPlog(curr);
-    }
-
-    pthread_exit((void *)0);
-}
-
-//rendering service
-void *Service_3(void *threadp)
-{
-    struct timeval current_time_val;
-    unsigned long long S3Cnt = 0;
-    plog_t *curr;
-
-    char message[MAX_MSG_LEN];
-
-    if (debug) {
-        gettimeofday(&current_time_val, (struct timezone *)0);
-        snprintf(message, MAX_MSG_LEN, "Rendering thread @ sec=%d, msec=%d\n",
-                 (int)(current_time_val.tv_sec - start_time_val.tv_sec),
-                 (int)current_time_val.tv_usec / USEC_PER_MSEC);
-        printf("%s", message);
-    }
-
-    Mat disp;
-    cvNamedWindow("Video");
-    setWindowProperty("Video", CV_WND_PROP_FULLSCREEN, CV_WINDOW_FULLSCREEN);
-
-    while (!abortS3) {
-        sem_wait(&semS3);
-        getStartPlog(&buff, &curr, 3);
-        S3Cnt++;
-
-        src.copyTo(disp);
-
-        write_ui(disp, score);
-        goal.draw(disp);
-
-
-        unsigned int i;
-        for(i = 0; i < NUM_OBS; i++)
-        {
-            obstacles[i].draw(disp);
-        }
-
-        player.draw(disp);
-
-        if(gameOver)
-        {
-	  // putText(disp, "Game Over", Point(VIDEO_WIDTH/4, VIDEO_HEIGHT/3), FONT_HERSHEY_COMPLEX_SMALL, 1,
-	  //       Scalar(100, 100, 100), 1, CV_AA);
-        }
-        else if (isPaused) 
-        {
-            putText(disp, "Game Paused", Point(VIDEO_WIDTH/4, VIDEO_HEIGHT/3), FONT_HERSHEY_COMPLEX_SMALL, 1,
-                    Scalar(100, 100, 100), 1, CV_AA);
-        }
-
-
-        resize(disp, disp, Size(), 2.5, 2.5);
-
-        // if (detect_collision(goal, o)) {
-        //     putText(disp, "Collision!", Point(40, 40), FONT_HERSHEY_COMPLEX_SMALL, 5,
-        //             Scalar(100, 100, 100), 1, CV_AA);
-        // }
-
-        if (!disp.empty()) {
-            imshow("Video", disp);
-            int c = cvWaitKey(10);
-            //If 'ESC' is pressed, break the loop
-            if ((char)c == 27 ) {
-                break;
+        if (pipelines[p].archive.running) {
+            archive_stop(&pipelines[p].archive);
+            for (s = 0; s < archive_num_streams; s++) {
+                printf("%s archive %s: %llu written, %llu dropped, "
+                       "%llu failed\n", pipelines[p].window,
+                       (s == archive_camera) ? "camera" : "rendered",
+                       pipelines[p].archive.queues[s].written,
+                       pipelines[p].archive.queues[s].dropped,
+                       pipelines[p].archive.queues[s].failed);
             }
         }
+    }
+    telemetry_destroy(telemetry);
 
-        if (debug) {
-            gettimeofday(&current_time_val, (struct timezone *)0);
-            snprintf(message, MAX_MSG_LEN, "Rendering release %llu @ sec=%d, msec=%d\n",
-                     S3Cnt,
-                     (int)(current_time_val.tv_sec - start_time_val.tv_sec),
-                     (int)current_time_val.tv_usec / USEC_PER_MSEC);
-            printf("%s", message);
-        }
-
-        endPlog(curr);
+    evlog_stop();
+    if (evlog_dropped() > 0) {
+        printf("Event log dropped %llu messages\n", evlog_dropped());
     }
 
-    cvDestroyAllWindows();
-    pthread_exit((void *)0);
+    printf("\nGame Over\n");
 }
-
-
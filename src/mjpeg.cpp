@@ -0,0 +1,209 @@
+
+/*
+** Copyright 2018 Benjamin J. Andre.
+** All Rights Reserved.
+**
+** This Source Code Form is subject to the terms of the Mozilla
+** Public License, v. 2.0. If a copy of the MPL was not distributed
+** with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*/
+
+#include <errno.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "mjpeg.hpp"
+
+using namespace cv;
+
+static const uint8_t MARKER = 0xff;
+static const uint8_t SOI = 0xd8;
+static const uint8_t EOI = 0xd9;
+
+bool mjpeg_file(const char *filename)
+{
+    const char *ext = filename ? strrchr(filename, '.') : NULL;
+
+    return ext && (strcasecmp(ext, ".mjpeg") == 0 ||
+                   strcasecmp(ext, ".mjpg") == 0);
+}
+
+int mjpeg_open(mjpeg_stream_t *stream, const char *filename)
+{
+    struct stat st;
+    void *map;
+
+    memset(stream, 0, sizeof(*stream));
+    stream->fd = open(filename, O_RDONLY);
+    if (stream->fd < 0) {
+        return -1;
+    }
+
+    if (fstat(stream->fd, &st) < 0) {
+        close(stream->fd);
+        stream->fd = -1;
+        return -1;
+    }
+    if (st.st_size == 0) {
+        close(stream->fd);
+        stream->fd = -1;
+        errno = EINVAL;
+        return -1;
+    }
+
+    // the whole recording stays resident, frames are read in place
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE,
+               stream->fd, 0);
+    if (map == MAP_FAILED) {
+        close(stream->fd);
+        stream->fd = -1;
+        return -1;
+    }
+
+    stream->data = (const uint8_t *)map;
+    stream->size = st.st_size;
+    return 0;
+}
+
+// index of marker m at or after from, size if there is none
+static size_t find_marker(const mjpeg_stream_t *stream, size_t from,
+                          uint8_t m)
+{
+    const uint8_t *p = stream->data + from;
+    const uint8_t *end = stream->data + stream->size;
+
+    // entropy coded data stuffs 0xff as ff 00, so ff d9 only ends a frame
+    while (p + 1 < end) {
+        p = (const uint8_t *)memchr(p, MARKER, end - p - 1);
+        if (!p) {
+            break;
+        }
+        if (p[1] == m) {
+            return p - stream->data;
+        }
+        p++;
+    }
+    return stream->size;
+}
+
+int mjpeg_next(mjpeg_stream_t *stream, const uint8_t **frame, size_t *len)
+{
+    unsigned int pass;
+
+    for (pass = 0; pass < 2; pass++) {
+        size_t start = find_marker(stream, stream->offset, SOI);
+        size_t end = find_marker(stream, start, EOI);
+
+        if (end < stream->size) {
+            *frame = stream->data + start;
+            *len = end + 2 - start;
+            stream->offset = end + 2;
+            stream->frames++;
+            return 0;
+        }
+
+        // ran off the end, loop the recording
+        stream->offset = 0;
+    }
+
+    return -1;
+}
+
+void mjpeg_close(mjpeg_stream_t *stream)
+{
+    if (stream->data) {
+        munmap((void *)stream->data, stream->size);
+    }
+    if (stream->fd >= 0) {
+        close(stream->fd);
+    }
+    memset(stream, 0, sizeof(*stream));
+    stream->fd = -1;
+}
+
+unsigned int mjpeg_scale(Size image, Size target)
+{
+    unsigned int denom = 1;
+
+    // libjpeg rounds scaled dimensions up
+    while (denom < MJPEG_MAX_SCALE &&
+            (image.width + 2 * (int)denom - 1) / (2 * (int)denom) >=
+            target.width &&
+            (image.height + 2 * (int)denom - 1) / (2 * (int)denom) >=
+            target.height) {
+        denom *= 2;
+    }
+    return denom;
+}
+
+static void on_error(j_common_ptr cinfo)
+{
+    mjpeg_error_t *err = (mjpeg_error_t *)cinfo->err;
+    longjmp(err->escape, 1);
+}
+
+// camera streams routinely carry recoverable corrupt data warnings, do not
+// print them from the frame service
+static void on_message(j_common_ptr cinfo, int level)
+{
+    (void)cinfo;
+    (void)level;
+}
+
+MjpegDecoder::MjpegDecoder() : denom(1)
+{
+    cinfo.err = jpeg_std_error(&err.pub);
+    err.pub.error_exit = on_error;
+    err.pub.emit_message = on_message;
+    jpeg_create_decompress(&cinfo);
+}
+
+MjpegDecoder::~MjpegDecoder()
+{
+    jpeg_destroy_decompress(&cinfo);
+}
+
+unsigned int MjpegDecoder::scale() const
+{
+    return denom;
+}
+
+int MjpegDecoder::decode(const uint8_t *data, size_t len, Size target,
+                         Mat &bgr)
+{
+    JSAMPROW row;
+
+    if (setjmp(err.escape)) {
+        jpeg_abort_decompress(&cinfo);
+        return -1;
+    }
+
+    // USB cameras often leave out the Huffman tables, libjpeg-turbo falls
+    // back to the standard ones
+    jpeg_mem_src(&cinfo, (unsigned char *)data, (unsigned long)len);
+    jpeg_read_header(&cinfo, TRUE);
+
+    denom = mjpeg_scale(Size(cinfo.image_width, cinfo.image_height), target);
+    cinfo.scale_num = 1;
+    cinfo.scale_denom = denom;
+    cinfo.out_color_space = JCS_EXT_BGR;
+    cinfo.dct_method = JDCT_IFAST;
+    cinfo.do_fancy_upsampling = FALSE;
+    cinfo.do_block_smoothing = FALSE;
+
+    jpeg_start_decompress(&cinfo);
+
+    bgr.create(cinfo.output_height, cinfo.output_width, CV_8UC3);
+    while (cinfo.output_scanline < cinfo.output_height) {
+        row = bgr.ptr<uint8_t>(cinfo.output_scanline);
+        jpeg_read_scanlines(&cinfo, &row, 1);
+    }
+
+    jpeg_finish_decompress(&cinfo);
+    return 0;
+}
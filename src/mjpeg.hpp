@@ -0,0 +1,109 @@
+/**
+   \file mjpeg.hpp
+
+   Motion JPEG streams decoded with libjpeg DCT scaling, so a high
+   resolution camera stream can be decoded straight to the tracking size.
+ */
+
+/*
+** Copyright 2018 Benjamin J. Andre.
+** All Rights Reserved.
+**
+** This Source Code Form is subject to the terms of the Mozilla
+** Public License, v. 2.0. If a copy of the MPL was not distributed
+** with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*/
+
+#ifndef RTES_MJPEG_H_
+#define RTES_MJPEG_H_
+
+#include <setjmp.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <jpeglib.h>
+
+#include <opencv2/opencv.hpp>
+
+/** largest DCT scaling denominator libjpeg supports */
+static const unsigned int MJPEG_MAX_SCALE = 8u;
+
+/**
+   A raw MJPEG recording (concatenated JPEG frames, e.g. the camera stream
+   dumped with ffmpeg -c:v copy -f mjpeg), mapped into memory.
+ */
+typedef struct {
+    int fd;
+    const uint8_t *data;
+    size_t size;
+    size_t offset;              /*!< where the next frame search starts */
+    unsigned long long frames;  /*!< frames returned so far */
+} mjpeg_stream_t;
+
+/**
+   true when the file name looks like a raw MJPEG recording
+ */
+bool mjpeg_file(const char *filename);
+
+/**
+   \return 0 on success, -1 with errno set
+ */
+int mjpeg_open(mjpeg_stream_t *stream, const char *filename);
+
+/**
+   Next complete frame, from its SOI to its EOI marker. Rewinds at the end
+   of the recording.
+
+   \return 0 on success, -1 if the recording holds no complete frame
+ */
+int mjpeg_next(mjpeg_stream_t *stream, const uint8_t **frame, size_t *len);
+
+void mjpeg_close(mjpeg_stream_t *stream);
+
+/**
+   Largest power of two DCT scaling denominator that still decodes an
+   image of size image to at least target in both dimensions.
+ */
+unsigned int mjpeg_scale(cv::Size image, cv::Size target);
+
+typedef struct {
+    struct jpeg_error_mgr pub;
+    jmp_buf escape;
+} mjpeg_error_t;
+
+/**
+   Decodes JPEG frames to BGR at the smallest DCT scale that covers the
+   requested size. The IDCT of a scaled decode only computes the low
+   frequency coefficients and color conversion runs on the scaled image,
+   so decoding a 1280x960 frame at 1/4 costs a fraction of a full decode.
+   The decompressor is reused across frames.
+ */
+class MjpegDecoder
+{
+  public:
+    MjpegDecoder();
+    ~MjpegDecoder();
+
+    /**
+       Decode one frame into bgr, which is (re)allocated only when the
+       output size changes.
+
+       \return 0 on success, -1 on a corrupt or truncated frame
+     */
+    int decode(const uint8_t *data, size_t len, cv::Size target,
+               cv::Mat &bgr);
+
+    /** denominator of the last decode, 1 for full size */
+    unsigned int scale() const;
+
+  private:
+    MjpegDecoder(const MjpegDecoder &);
+    MjpegDecoder &operator=(const MjpegDecoder &);
+
+    struct jpeg_decompress_struct cinfo;
+    mjpeg_error_t err;
+    unsigned int denom;
+};
+
+#endif /* RTES_MJPEG_H_ */
@@ -0,0 +1,180 @@
+
+/*
+** Copyright 2018 Benjamin J. Andre.
+** All Rights Reserved.
+**
+** This Source Code Form is subject to the terms of the Mozilla
+** Public License, v. 2.0. If a copy of the MPL was not distributed
+** with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*/
+
+#include <stdint.h>
+
+#include "overlay.hpp"
+
+static const int LINE_TYPE = 8;
+
+static uint64_t ring_key(int radius, const Scalar &color, int thickness)
+{
+    uint64_t key = (uint64_t)(radius & 0xffff) << 32;
+    key |= (uint64_t)(thickness & 0xff) << 24;
+    key |= (uint64_t)((int)color.val[0] & 0xff) << 16;
+    key |= (uint64_t)((int)color.val[1] & 0xff) << 8;
+    key |= (uint64_t)((int)color.val[2] & 0xff);
+    return key;
+}
+
+static sprite_t render_ring(int radius, const Scalar &color, int thickness)
+{
+    sprite_t sprite;
+    int margin = radius + thickness + 1;
+    int side = 2 * margin + 1;
+
+    sprite.anchor = Point(margin, margin);
+    sprite.advance = 0;
+    sprite.binary = true;
+    sprite.bgr = Mat::zeros(side, side, CV_8UC3);
+    sprite.mask = Mat::zeros(side, side, CV_8UC1);
+
+    circle(sprite.bgr, sprite.anchor, radius, color, thickness, LINE_TYPE, 0);
+    circle(sprite.mask, sprite.anchor, radius, Scalar(255), thickness,
+           LINE_TYPE, 0);
+
+    return sprite;
+}
+
+static void blend_sprite(Mat &dst, const Mat &bgr, const Mat &mask)
+{
+    int x, y, c;
+    for (y = 0; y < dst.rows; y++) {
+        uchar *d = dst.ptr<uchar>(y);
+        const uchar *s = bgr.ptr<uchar>(y);
+        const uchar *m = mask.ptr<uchar>(y);
+
+        for (x = 0; x < dst.cols; x++) {
+            unsigned int a = m[x];
+            if (a == 0) {
+                continue;
+            }
+            for (c = 0; c < 3; c++) {
+                unsigned int v = s[3 * x + c] * a + d[3 * x + c] * (255u - a);
+                d[3 * x + c] = (uchar)((v + 127u) / 255u);
+            }
+        }
+    }
+}
+
+void blit_sprite(Mat &image, const sprite_t &sprite, Point pos)
+{
+    Rect area(pos.x - sprite.anchor.x, pos.y - sprite.anchor.y,
+              sprite.bgr.cols, sprite.bgr.rows);
+    Rect clipped = area & Rect(0, 0, image.cols, image.rows);
+
+    if (clipped.area() <= 0) {
+        return;
+    }
+
+    Rect from(clipped.x - area.x, clipped.y - area.y,
+              clipped.width, clipped.height);
+    Mat dst = image(clipped);
+
+    if (sprite.binary) {
+        sprite.bgr(from).copyTo(dst, sprite.mask(from));
+    } else {
+        blend_sprite(dst, sprite.bgr(from), sprite.mask(from));
+    }
+}
+
+void SpriteAtlas::prepare_ring(int radius, const Scalar &color, int thickness)
+{
+    (void)ring(radius, color, thickness);
+}
+
+const sprite_t &SpriteAtlas::ring(int radius, const Scalar &color,
+                                  int thickness)
+{
+    uint64_t key = ring_key(radius, color, thickness);
+    std::map<uint64_t, sprite_t>::iterator it = rings.find(key);
+
+    if (it == rings.end()) {
+        it = rings.insert(std::make_pair(key, render_ring(radius, color,
+                                         thickness))).first;
+    }
+    return it->second;
+}
+
+size_t SpriteAtlas::size() const
+{
+    return rings.size();
+}
+
+GlyphCache::GlyphCache(int font, double scale, const Scalar &color,
+                       int thickness)
+    : font(font), scale(scale), color(color), thickness(thickness)
+{
+    char digit[2] = {'0', '\0'};
+    int i;
+
+    for (i = 0; i < 10; i++) {
+        digit[0] = (char)('0' + i);
+        digits[i] = render(digit);
+    }
+}
+
+sprite_t GlyphCache::render(const std::string &text) const
+{
+    sprite_t sprite;
+    int baseline = 0;
+    Size extent = getTextSize(text, font, scale, thickness, &baseline);
+    int pad = thickness + 1;
+
+    sprite.anchor = Point(pad, pad + extent.height);
+    sprite.advance = extent.width;
+    sprite.binary = false;
+    sprite.mask = Mat::zeros(extent.height + baseline + 2 * pad,
+                             extent.width + 2 * pad, CV_8UC1);
+    sprite.bgr = Mat(sprite.mask.rows, sprite.mask.cols, CV_8UC3, color);
+
+    putText(sprite.mask, text, sprite.anchor, font, scale, Scalar(255),
+            thickness, CV_AA);
+
+    return sprite;
+}
+
+void GlyphCache::prepare_label(const std::string &label)
+{
+    if (labels.find(label) == labels.end()) {
+        labels[label] = render(label);
+    }
+}
+
+Point GlyphCache::draw_label(Mat &image, const std::string &label, Point pos)
+{
+    std::map<std::string, sprite_t>::iterator it = labels.find(label);
+
+    if (it == labels.end()) {
+        it = labels.insert(std::make_pair(label, render(label))).first;
+    }
+    blit_sprite(image, it->second, pos);
+
+    return Point(pos.x + it->second.advance, pos.y);
+}
+
+Point GlyphCache::draw_number(Mat &image, unsigned int value, Point pos)
+{
+    unsigned int reversed[10];
+    int n = 0;
+
+    do {
+        reversed[n++] = value % 10;
+        value /= 10;
+    } while (value > 0);
+
+    while (n > 0) {
+        const sprite_t &glyph = digits[reversed[--n]];
+        blit_sprite(image, glyph, pos);
+        pos.x += glyph.advance;
+    }
+
+    return pos;
+}
@@ -0,0 +1,104 @@
+/**
+   \file overlay.hpp
+
+   Pre-rendered sprites and glyphs for drawing the game overlay.
+ */
+
+/*
+** Copyright 2018 Benjamin J. Andre.
+** All Rights Reserved.
+**
+** This Source Code Form is subject to the terms of the Mozilla
+** Public License, v. 2.0. If a copy of the MPL was not distributed
+** with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*/
+
+#ifndef RTES_OVERLAY_H_
+#define RTES_OVERLAY_H_
+
+#include <stdint.h>
+
+#include <map>
+#include <string>
+
+#include <opencv2/opencv.hpp>
+
+using namespace cv;
+
+/**
+   A pre-rendered image and its coverage mask.
+
+   anchor is the pixel in the sprite that lands on the draw position, i.e. the
+   circle center or the text baseline origin. Binary sprites are blitted with a
+   masked copy, anti-aliased sprites are alpha blended.
+ */
+typedef struct {
+    Mat bgr;
+    Mat mask;
+    Point anchor;
+    int advance;
+    bool binary;
+} sprite_t;
+
+/**
+   Copy a sprite into image with its anchor at pos, clipped to the image.
+ */
+void blit_sprite(Mat &image, const sprite_t &sprite, Point pos);
+
+/**
+   Cache of circle outline sprites keyed by radius, thickness and color.
+
+   Sprites are rasterized with the same cv::circle call the objects used to
+   make directly, so blitting them is pixel identical. Call prepare_ring()
+   during initialization for every known size so the render loop never
+   allocates; a miss in ring() renders and caches the sprite on the spot.
+ */
+class SpriteAtlas
+{
+  public:
+    void prepare_ring(int radius, const Scalar &color, int thickness);
+    const sprite_t &ring(int radius, const Scalar &color, int thickness);
+    size_t size() const;
+
+  private:
+    std::map<uint64_t, sprite_t> rings;
+};
+
+/**
+   Cache of anti-aliased text sprites for one Hershey font and color.
+
+   Digits are always cached so numbers can be composed without formatting a
+   string. Labels are cached whole by prepare_label().
+ */
+class GlyphCache
+{
+  public:
+    GlyphCache(int font, double scale, const Scalar &color, int thickness);
+    void prepare_label(const std::string &label);
+
+    /**
+       Draw a cached label with its baseline origin at pos.
+
+       \return origin for the next piece of text on the same line
+     */
+    Point draw_label(Mat &image, const std::string &label, Point pos);
+
+    /**
+       Draw a non-negative integer with its baseline origin at pos.
+
+       \return origin for the next piece of text on the same line
+     */
+    Point draw_number(Mat &image, unsigned int value, Point pos);
+
+  private:
+    sprite_t render(const std::string &text) const;
+
+    int font;
+    double scale;
+    Scalar color;
+    int thickness;
+    sprite_t digits[10];
+    std::map<std::string, sprite_t> labels;
+};
+
+#endif /* RTES_OVERLAY_H_ */
@@ -0,0 +1,153 @@
+
+/*
+** Copyright 2018 Benjamin J. Andre.
+** All Rights Reserved.
+**
+** This Source Code Form is subject to the terms of the Mozilla
+** Public License, v. 2.0. If a copy of the MPL was not distributed
+** with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*/
+
+#include <stdint.h>
+#include <string.h>
+
+#include <pthread.h>
+#include <time.h>
+
+#include "constants.hpp"
+#include "overload.hpp"
+
+// degrade when a job uses more than HIGH_WATER_PCT of its period, restore one
+// level once every watched service stayed under LOW_WATER_PCT for CALM_JOBS
+// jobs. HOLDOFF_JOBS completions must pass after any change so the effect of
+// a level is measured before the next one, each service counts its own.
+static const uint64_t HIGH_WATER_PCT = 90u;
+static const uint64_t LOW_WATER_PCT = 50u;
+static const unsigned int CALM_JOBS = 30u;
+static const unsigned int HOLDOFF_JOBS = 5u;
+
+static uint64_t timespec_ns(const struct timespec *t)
+{
+    return (uint64_t)t->tv_sec * NANOSEC_PER_SEC + (uint64_t)t->tv_nsec;
+}
+
+void overload_init(overload_t *ctrl, plog_buffer_t *trace)
+{
+    pthread_mutexattr_t attr;
+
+    memset(ctrl, 0, sizeof(*ctrl));
+    ctrl->level = quality_full;
+    ctrl->trace = trace;
+
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setprotocol(&attr, PTHREAD_PRIO_INHERIT);
+    pthread_mutex_init(&ctrl->lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+void overload_watch(overload_t *ctrl, unsigned int service, uint64_t period)
+{
+    ctrl->services[service].watched = true;
+    ctrl->services[service].period = period;
+}
+
+void overload_release(overload_t *ctrl, unsigned int service)
+{
+    overload_service_t *s = &ctrl->services[service];
+    unsigned long long n = s->released;
+    overload_stamp_t *stamp = &s->release[n % OVERLOAD_RELEASE_HISTORY];
+
+    // a full ring holds the stamps of jobs still to complete, keep those
+    if (n - s->completed >= OVERLOAD_RELEASE_HISTORY) {
+        s->lost++;
+    } else {
+        clock_gettime(CLOCK_REALTIME, &stamp->time);
+        stamp->release = n;
+    }
+    __sync_synchronize();
+    s->released++;
+}
+
+static bool all_calm(const overload_t *ctrl)
+{
+    unsigned int i;
+    for (i = 0; i < OVERLOAD_MAX_SERVICES; i++) {
+        if (ctrl->services[i].watched && ctrl->services[i].calm < CALM_JOBS) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void change_level(overload_t *ctrl, int level, overload_reason_t reason,
+                         unsigned int service)
+{
+    unsigned int i;
+
+    ctrl->level = level;
+    for (i = 0; i < OVERLOAD_MAX_SERVICES; i++) {
+        ctrl->services[i].calm = 0;
+        ctrl->services[i].holdoff = HOLDOFF_JOBS;
+    }
+
+    eventPlog(ctrl->trace, PLOG_ID_OVERLOAD,
+              (uint32_t)level | ((uint32_t)reason << 8) | (service << 16));
+}
+
+uint64_t overload_complete(overload_t *ctrl, unsigned int service)
+{
+    overload_service_t *s = &ctrl->services[service];
+    const overload_stamp_t *stamp =
+        &s->release[s->completed % OVERLOAD_RELEASE_HISTORY];
+    struct timespec now;
+    uint64_t response;
+
+    // the slot still holds an older release's stamp when this one was lost
+    if (stamp->release != s->completed) {
+        __sync_synchronize();
+        s->completed++;
+        return 0;
+    }
+
+    clock_gettime(CLOCK_REALTIME, &now);
+    response = timespec_ns(&now) - timespec_ns(&stamp->time);
+    // frees the slot for the sequencer
+    __sync_synchronize();
+    s->completed++;
+    s->lastResponse = response;
+
+    if (!s->watched) {
+        return response;
+    }
+
+    pthread_mutex_lock(&ctrl->lock);
+
+    if (response * 100u < s->period * LOW_WATER_PCT) {
+        s->calm++;
+    } else {
+        s->calm = 0;
+    }
+
+    if (s->holdoff > 0) {
+        s->holdoff--;
+    } else if (response > s->period) {
+        if (ctrl->level < quality_num_levels - 1) {
+            change_level(ctrl, ctrl->level + 1, overload_overrun, service);
+        }
+    } else if (response * 100u > s->period * HIGH_WATER_PCT) {
+        if (ctrl->level < quality_num_levels - 1) {
+            change_level(ctrl, ctrl->level + 1, overload_high_water, service);
+        }
+    } else if (ctrl->level > quality_full && all_calm(ctrl)) {
+        change_level(ctrl, ctrl->level - 1, overload_headroom, service);
+    }
+
+    pthread_mutex_unlock(&ctrl->lock);
+
+    return response;
+}
+
+quality_level_t overload_level(const overload_t *ctrl)
+{
+    return (quality_level_t)ctrl->level;
+}
@@ -0,0 +1,122 @@
+/**
+   \file overload.hpp
+
+   Overload controller that trades tracking and rendering quality for
+   schedulability.
+ */
+
+/*
+** Copyright 2018 Benjamin J. Andre.
+** All Rights Reserved.
+**
+** This Source Code Form is subject to the terms of the Mozilla
+** Public License, v. 2.0. If a copy of the MPL was not distributed
+** with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*/
+
+#ifndef RTES_OVERLOAD_H_
+#define RTES_OVERLOAD_H_
+
+#include <stdint.h>
+
+#include <pthread.h>
+#include <time.h>
+
+#include "plog.hpp"
+
+/**
+   plog id of mode change events. The arg column holds
+   level | (reason << 8) | (service << 16).
+ */
+static const uint32_t PLOG_ID_OVERLOAD = 16u;
+
+static const unsigned int OVERLOAD_MAX_SERVICES = 4u;
+static const unsigned int OVERLOAD_RELEASE_HISTORY = 16u;
+
+/**
+   Degradation levels, each one includes all of the ones before it.
+ */
+typedef enum quality_level_t_ {
+    quality_full = 0,       /*!< full frame, full resolution, every frame */
+    quality_roi = 1,        /*!< track only in a window around the players */
+    quality_half_res = 2,   /*!< detect on half resolution masks */
+    quality_no_blur = 3,    /*!< skip the median blur of the masks */
+    quality_half_render = 4,/*!< render every other release */
+    quality_num_levels,
+} quality_level_t;
+
+typedef enum overload_reason_t_ {
+    overload_overrun = 1,   /*!< response time exceeded the period */
+    overload_high_water = 2,/*!< response time above the high water mark */
+    overload_headroom = 3,  /*!< all services below the low water mark */
+} overload_reason_t;
+
+typedef struct {
+    struct timespec time;
+    unsigned long long release;     /*!< release count the stamp belongs to */
+} overload_stamp_t;
+
+/**
+   Release history and controller state of one service.
+
+   The sequencer stamps each release into a ring indexed by release count.
+   The service's n-th job consumes the n-th release, so its response time is
+   measured from that stamp even when releases pile up on the semaphore.
+   The ring never overwrites a stamp that is still to be consumed, a release
+   finding it full is counted as lost and its job is left out of the
+   controller.
+ */
+typedef struct {
+    bool watched;
+    uint64_t period;
+    volatile unsigned long long released;
+    volatile unsigned long long completed;
+    overload_stamp_t release[OVERLOAD_RELEASE_HISTORY];
+    volatile unsigned long long lost;   /*!< releases the ring was full for */
+    unsigned int calm;
+    unsigned int holdoff;   /*!< own jobs to ignore after a level change */
+    uint64_t lastResponse;
+} overload_service_t;
+
+typedef struct {
+    pthread_mutex_t lock;
+    volatile int level;
+    plog_buffer_t *trace;
+    overload_service_t services[OVERLOAD_MAX_SERVICES];
+} overload_t;
+
+/**
+   Initialize the controller at full quality
+
+   \param[in,out] ctrl controller
+   \param[in] trace plog buffer that mode change events are written to
+ */
+void overload_init(overload_t *ctrl, plog_buffer_t *trace);
+
+/**
+   Make a service's response times drive the degradation level
+
+   \param[in] service plog id of the service
+   \param[in] period release period in nanoseconds
+ */
+void overload_watch(overload_t *ctrl, unsigned int service, uint64_t period);
+
+/**
+   Stamp a release, called by the sequencer just before posting the service
+ */
+void overload_release(overload_t *ctrl, unsigned int service);
+
+/**
+   Account for a completed job, called by the service at the end of each job
+
+   \return response time of the job in nanoseconds, 0 if its release stamp
+   was lost
+ */
+uint64_t overload_complete(overload_t *ctrl, unsigned int service);
+
+/**
+   Current degradation level, read by the services at the start of each job
+ */
+quality_level_t overload_level(const overload_t *ctrl);
+
+#endif /* RTES_OVERLOAD_H_ */
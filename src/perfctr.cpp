@@ -0,0 +1,133 @@
+
+/*
+** Copyright 2018 Benjamin J. Andre.
+** All Rights Reserved.
+**
+** This Source Code Form is subject to the terms of the Mozilla
+** Public License, v. 2.0. If a copy of the MPL was not distributed
+** with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+
+#include "perfctr.hpp"
+
+static bool enabled = false;
+
+static const struct {
+    uint32_t type;
+    uint64_t config;
+} events[perfctr_num] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES},
+    {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS},
+};
+
+// group leader of the calling thread and the position of each counter in
+// a PERF_FORMAT_GROUP read, -1 if the counter could not be opened
+static __thread int groupFd = -1;
+static __thread int fds[perfctr_num];
+static __thread int slot[perfctr_num];
+
+typedef struct {
+    uint64_t nr;
+    uint64_t values[perfctr_num];
+} group_read_t;
+
+static int perf_event_open(struct perf_event_attr *attr, int group)
+{
+    // pid 0 and cpu -1 count the calling thread on any cpu
+    return (int)syscall(SYS_perf_event_open, attr, 0, -1, group, 0);
+}
+
+void perfctr_enable(void)
+{
+    enabled = true;
+}
+
+int perfctr_open_thread(void)
+{
+    struct perf_event_attr attr;
+    int opened = 0;
+    int i;
+
+    if (!enabled) {
+        return 0;
+    }
+
+    for (i = 0; i < perfctr_num; i++) {
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = events[i].type;
+        attr.config = events[i].config;
+        attr.read_format = PERF_FORMAT_GROUP;
+        attr.disabled = (groupFd < 0) ? 1 : 0;
+        attr.exclude_hv = 1;
+
+        fds[i] = perf_event_open(&attr, groupFd);
+        if (fds[i] < 0) {
+            slot[i] = -1;
+            continue;
+        }
+        if (groupFd < 0) {
+            groupFd = fds[i];
+        }
+        slot[i] = opened++;
+    }
+
+    if (groupFd < 0) {
+        perror("perf_event_open");
+        return -1;
+    }
+
+    ioctl(groupFd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(groupFd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+
+    return opened;
+}
+
+void perfctr_close_thread(void)
+{
+    int i;
+
+    if (groupFd < 0) {
+        return;
+    }
+
+    // members first, the leader last
+    for (i = 0; i < perfctr_num; i++) {
+        if (slot[i] >= 0 && fds[i] != groupFd) {
+            close(fds[i]);
+        }
+    }
+    close(groupFd);
+    groupFd = -1;
+}
+
+int perfctr_read(uint64_t *values)
+{
+    group_read_t group;
+    int i;
+
+    if (groupFd < 0) {
+        return -1;
+    }
+
+    if (read(groupFd, &group, sizeof(group)) < (ssize_t)sizeof(uint64_t)) {
+        return -1;
+    }
+
+    for (i = 0; i < perfctr_num; i++) {
+        values[i] = (slot[i] >= 0) ? group.values[slot[i]] : 0;
+    }
+    return 0;
+}
@@ -0,0 +1,64 @@
+/**
+   \file perfctr.hpp
+
+   Optional per-thread hardware and software performance counters, sampled
+   around each plog record.
+ */
+
+/*
+** Copyright 2018 Benjamin J. Andre.
+** All Rights Reserved.
+**
+** This Source Code Form is subject to the terms of the Mozilla
+** Public License, v. 2.0. If a copy of the MPL was not distributed
+** with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*/
+
+#ifndef RTES_PERFCTR_H_
+#define RTES_PERFCTR_H_
+
+#include <stdint.h>
+
+/**
+   Counters in the order they are stored in plog records and csv traces
+ */
+typedef enum perfctr_t_ {
+    perfctr_instructions = 0,
+    perfctr_cycles,
+    perfctr_llc_misses,   /*!< PERF_COUNT_HW_CACHE_MISSES, usually the LLC */
+    perfctr_ctx_switches,
+    perfctr_page_faults,
+    perfctr_num,
+} perfctr_t;
+
+/**
+   Turn counting on for threads that call perfctr_open_thread() afterwards.
+   Must be called before the threads are created.
+ */
+void perfctr_enable(void);
+
+/**
+   Open a counter group on the calling thread if counting is enabled
+
+   Counters the kernel or hardware does not support (common in virtual
+   machines) are left out and read as zero.
+
+   \return number of counters opened, 0 when disabled, -1 on error
+ */
+int perfctr_open_thread(void);
+
+/**
+   Close the calling thread's counter group
+ */
+void perfctr_close_thread(void);
+
+/**
+   Read the calling thread's counters
+
+   \param[out] values perfctr_num running totals
+
+   \return 0 on success, -1 when the thread has no counter group
+ */
+int perfctr_read(uint64_t *values);
+
+#endif /* RTES_PERFCTR_H_ */
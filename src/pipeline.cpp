@@ -0,0 +1,668 @@
+
+/*
+** Copyright 2018 Benjamin J. Andre.
+** All Rights Reserved.
+**
+** This Source Code Form is subject to the terms of the Mozilla
+** Public License, v. 2.0. If a copy of the MPL was not distributed
+** with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
+
+#include <opencv2/opencv.hpp>
+#include "gameutil.hpp"
+#include "gameobjects.hpp"
+#include "tracker.hpp"
+#include "detect.hpp"
+#include "overload.hpp"
+#include "warmup.hpp"
+#include "perfctr.hpp"
+#include "telemetry.hpp"
+#include "evlog.hpp"
+
+using namespace cv;
+
+#include "constants.hpp"
+#include "thread_context.hpp"
+#include "frame_source.hpp"
+#include "pipeline.hpp"
+
+#include "plog.hpp"
+
+static const bool debug = false;
+
+static const unsigned int PLAYER_RADIUS = 10;
+
+// ten minutes of jobs of the three services plus their events
+static const size_t PIPELINE_PLOG_ENTRIES = 32768;
+
+// the window shows the game frame scaled up by this
+static const double DISPLAY_SCALE = 2.5;
+
+// prediction errors are traced in eighths of a pixel
+static const float PREDICTION_ERROR_SCALE = 8.0f;
+
+int pipeline_init(pipeline_t *pl, unsigned int id,
+                  const frame_source_config_t &source, telemetry_t *telemetry,
+                  sem_t *ready, sem_t *shown)
+{
+    unsigned int i;
+
+    pl->id = id;
+    pl->source = source;
+    pl->pinned = false;
+    CPU_ZERO(&pl->cpus);
+    pl->telemetry = telemetry;
+    pl->ready = ready;
+    pl->shown = shown;
+    pl->shownTime = 0;
+    pl->fullscreen = false;
+    pl->spectator.running = false;
+    pl->archive.running = false;
+    detect_params_default(&pl->detect);
+
+    // the first pipeline keeps the names of the single camera game
+    for (i = 0; i < NUM_SERVICES; i++) {
+        if (id == 0) {
+            snprintf(pl->names[i], PIPELINE_NAME_LEN, "Service_%u", i + 1);
+        } else {
+            snprintf(pl->names[i], PIPELINE_NAME_LEN, "P%u Service_%u", id,
+                     i + 1);
+        }
+    }
+    if (id == 0) {
+        snprintf(pl->window, PIPELINE_NAME_LEN, "Video");
+    } else {
+        snprintf(pl->window, PIPELINE_NAME_LEN, "Video %u", id);
+    }
+
+    for (i = 0; i < NUM_SERVICES; i++) {
+        pl->abort[i] = false;
+        pl->readyTime[i] = 0;
+        if (sem_init(&pl->release[i], 0, 0)) {
+            return -1;
+        }
+        pl->group.sems[i] = &pl->release[i];
+        pl->group.aborts[i] = &pl->abort[i];
+        pl->group.budgets[i] = &pl->budgets[i];
+        pl->group.violations[i] = 0;
+    }
+    pl->group.overload = &pl->overload;
+    pl->group.telemetry = telemetry;
+
+    if (initPlogBuff(PIPELINE_PLOG_ENTRIES, &pl->trace) < 0) {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    // degrade tracking and rendering quality when either overruns
+    overload_init(&pl->overload, &pl->trace);
+    overload_watch(&pl->overload, 2, period_ns(1));
+    overload_watch(&pl->overload, 3, period_ns(2));
+
+    // CPU time per job beyond the measured WCET, the tighter budgets of
+    // the schedulability checks are only for the analysis
+    for (i = 0; i < NUM_SERVICES; i++) {
+        budget_init(&pl->budgets[i], enforced_budget_ns(i), &pl->trace,
+                    pipeline_plog_id(pl, i + 1));
+    }
+
+    for (i = 0; i < NUM_SERVICES; i++) {
+        telemetry_watch(telemetry, i + 1, period_ns(i));
+    }
+
+    for (i = 0; i < NUM_PLAYERS; i++) {
+        pl->players[i] = Player(Point(VIDEO_WIDTH, VIDEO_HEIGHT),
+                                PLAYER_RADIUS);
+    }
+
+    for (i = 0; i < NUM_OBS; i++) {
+        pl->obstacles[i].speed = Point(rand() % 7 - 3, rand() % 7 - 3);
+        pl->obstacles[i].size = rand() % 10 + 5;
+    }
+
+    pl->goal = Goal(Point(200, 200), 15);
+    for (i = 0; i < NUM_PLAYERS; i++) {
+        pl->tracks[i] = track_t();
+    }
+    pl->frameTime = 0;
+    pl->displayLatency = DISPLAY_LATENCY_NSEC;
+    pl->goalCollision = false;
+    pl->gameOver = false;
+    pl->isPaused = false;
+
+    return 0;
+}
+
+uint32_t pipeline_plog_id(const pipeline_t *pl, uint32_t service)
+{
+    return service + pl->id * PIPELINE_PLOG_STRIDE;
+}
+
+// number of jobs each service runs before the sequencer starts
+static const unsigned int WARMUP_JOBS = 5;
+
+// report page faults a thread took after its warm-up
+static void print_steady_faults(const char *name, const fault_count_t *warm)
+{
+    fault_count_t now, delta;
+
+    get_thread_faults(&now);
+    delta = fault_delta(warm, &now);
+    printf("%s steady state page faults: minor=%ld major=%ld\n", name,
+           delta.minor, delta.major);
+}
+
+static void print_capture(const char *name, const capture_t *c)
+{
+    printf("%s capture: %llu frames, %llu dropped, %llu taken, %llu stale "
+           "jobs, %llu failed reads\n", name, c->captured, c->dropped,
+           c->taken, c->stale, c->failed);
+}
+
+// split the latest frame and update the motion mask and background model
+static void sample_frame(pipeline_t *pl, Mat bgr[3])
+{
+    pl->isPaused = sample_motion(pl->src, pl->detect, bgr, pl->rsrc, pl->acc,
+                                 pl->accScaled, pl->sub);
+}
+
+//frame grabbing and accumulating service
+void *Service_1(void *threadp)
+{
+    unsigned long long S1Cnt = 0;
+    uint64_t jobStart, response, captured = 0;
+    plog_t *curr;
+    fault_count_t warmFaults;
+    struct sched_param param;
+    int policy;
+
+    threadParams_t *threadParams = (threadParams_t *)threadp;
+    pipeline_t *pl = threadParams->pipeline;
+
+    prefault_stack(WARMUP_STACK_BYTES);
+    perfctr_open_thread();
+    evlog_register(pl->names[0]);
+
+    if (debug) {
+        evlog(evlog_s1_start);
+    }
+
+    Mat bgr[3];
+
+    // the camera is read by a thread below Service_3 on the background
+    // cpus, so it never delays a service and stays out of the release
+    // table's response time analysis. Reads it cannot fit in show up as
+    // dropped frames and stale jobs rather than as misses
+    pthread_getschedparam(pthread_self(), &policy, &param);
+    if (capture_start(&pl->capture, pl->source,
+                      (policy == SCHED_FIFO) ?
+                      param.sched_priority - (int)NUM_SERVICES : 0,
+                      &pl->captureCpus) < 0) {
+        perror("Service_1 frame source");
+    }
+
+    capture_wait(&pl->capture, pl->src, &captured);
+    split(pl->src, bgr);
+    pl->acc = Mat::zeros(bgr[2].size(), CV_32FC1);
+
+    // real camera frames, so the driver and the background model warm up too
+    for (unsigned int i = 0; i < WARMUP_JOBS; i++) {
+        capture_wait(&pl->capture, pl->src, &captured);
+        sample_frame(pl, bgr);
+    }
+
+    if (enter_deadline_mode(&threadParams->deadline) < 0) {
+        perror("Service_1 SCHED_DEADLINE");
+    }
+    if (budget_start(&pl->budgets[0]) < 0) {
+        perror("Service_1 budget timer");
+    }
+
+    get_thread_faults(&warmFaults);
+    pl->readyTime[0] = telemetry_now();
+    sem_post(pl->ready);
+
+    while (!pl->abort[0]) {
+        sem_wait(&pl->release[0]);
+        getStartPlog(&pl->trace, &curr, pipeline_plog_id(pl, 1));
+        budget_arm(&pl->budgets[0]);
+        jobStart = telemetry_now();
+        S1Cnt++;
+
+        // without a new frame the last one is already in the background
+        // model and motion mask, which stay as they are
+        if (capture_take(&pl->capture, pl->src, &captured)) {
+            sample_frame(pl, bgr);
+            pl->frameTime = captured;
+            telemetry_frame(pl->telemetry, S1Cnt);
+            archive_frame(&pl->archive, archive_camera, pl->src, S1Cnt,
+                          captured);
+        }
+
+        if (debug) {
+            evlog(evlog_s1_release, S1Cnt);
+        }
+
+        budget_complete(&pl->budgets[0]);
+
+        response = overload_complete(&pl->overload, 1);
+        telemetry_job(pl->telemetry, 1, telemetry_now() - jobStart, response);
+        endPlog(curr);
+    }
+
+    budget_stop(&pl->budgets[0]);
+    capture_stop(&pl->capture);
+    print_capture(pl->names[0], &pl->capture);
+    print_steady_faults(pl->names[0], &warmFaults);
+    perfctr_close_thread();
+    pthread_exit((void *)0);
+}
+
+// window around the joined players that tracking is restricted to when
+// overloaded, the whole frame if nobody has joined yet
+static Rect tracking_roi(const pipeline_t *pl, Size frame)
+{
+    int left = frame.width, top = frame.height, right = 0, bottom = 0;
+    int margin = (int)TRACKING_GATE;
+    unsigned int p;
+
+    for (p = 0; p < NUM_PLAYERS; p++) {
+        if (!pl->players[p].joined) {
+            continue;
+        }
+        left = min(left, pl->players[p].pos.x - margin);
+        top = min(top, pl->players[p].pos.y - margin);
+        right = max(right, pl->players[p].pos.x + margin);
+        bottom = max(bottom, pl->players[p].pos.y + margin);
+    }
+
+    if (right <= left || bottom <= top) {
+        return Rect(0, 0, frame.width, frame.height);
+    }
+
+    left = max(left, 0);
+    top = max(top, 0);
+    right = min(right, frame.width);
+    bottom = min(bottom, frame.height);
+
+    return Rect(left, top, right - left, bottom - top);
+}
+
+// how far the track's prediction for this frame was off, and over what
+// horizon, see PLOG_ID_PREDICTION
+static void trace_prediction(pipeline_t *pl, unsigned int player,
+                             const track_t &track, uint64_t previous)
+{
+    uint32_t error = (uint32_t)(track.error * PREDICTION_ERROR_SCALE);
+    uint32_t horizon = (previous && track.time > previous) ?
+                       (uint32_t)((track.time - previous) / 1000000u) : 0;
+
+    error = min(error, 0xffffu);
+    horizon = min(horizon, 0xffu);
+    eventPlog(&pl->trace, PLOG_ID_PREDICTION,
+              error | (horizon << 16) | (player << 24));
+}
+
+// move the players to their lasers, score goals and check obstacle hits
+static void update_game(pipeline_t *pl, Tracker &tracker, const vector<Point2f> &center,
+                        uint64_t frameTime)
+{
+    unsigned int i, p;
+    uint64_t previous[NUM_PLAYERS];
+
+    for(p = 0; p < NUM_PLAYERS; p++)
+    {
+        previous[p] = tracker.track(p).time;
+    }
+
+    tracker.update(center, frameTime);
+
+    for(p = 0; p < NUM_PLAYERS; p++)
+    {
+        const track_t &track = tracker.track(p);
+        if(track.updated)
+        {
+            pl->players[p].reposition(track.pos);
+            // a track started this frame made no prediction to be off
+            if(!track.started)
+            {
+                trace_prediction(pl, p, track, previous[p]);
+            }
+        }
+        // a player whose laser was lost leaves the game rather than staying
+        // collidable where it was last seen, a new laser in the slot joins
+        // afresh
+        pl->players[p].joined = track.active;
+        pl->tracks[p] = track;
+    }
+
+    for(p = 0; p < NUM_PLAYERS; p++)
+    {
+        if(pl->players[p].joined && detect_collision(pl->goal, pl->players[p]))
+        {
+            pl->players[p].score++;
+            pl->goal.pos = Point(rand()%VIDEO_WIDTH, rand()%VIDEO_HEIGHT);
+        }
+    }
+
+    for(p = 0; p < NUM_PLAYERS; p++)
+    {
+        for(i = 0; i < NUM_OBS; i++)
+        {
+            if(pl->players[p].joined && detect_collision(pl->obstacles[i], pl->players[p]))
+            {
+                pl->players[p].collided = true;
+                pl->gameOver = true;
+                if (debug) {
+                    evlog(evlog_s2_pre_collision, p, i);
+                }
+            }
+        }
+    }
+
+    for(i = 0; i < NUM_OBS; i++)
+    {
+        pl->obstacles[i].move();
+
+        if((pl->obstacles[i].pos.x > (signed)VIDEO_WIDTH) || (pl->obstacles[i].pos.x < 0))
+        {
+            pl->obstacles[i].speed.x *= -1;
+        }
+
+        if((pl->obstacles[i].pos.y > (signed)VIDEO_HEIGHT) || (pl->obstacles[i].pos.y < 0))
+        {
+            pl->obstacles[i].speed.y *= -1;
+        }
+    }
+
+    for(p = 0; p < NUM_PLAYERS; p++)
+    {
+        for(i = 0; i < NUM_OBS; i++)
+        {
+            if(pl->players[p].joined && detect_collision(pl->obstacles[i], pl->players[p]))
+            {
+                pl->players[p].collided = true;
+                pl->gameOver = true;
+                if (debug) {
+                    evlog(evlog_s2_post_collision, p, i);
+                }
+            }
+        }
+    }
+
+    if(pl->gameOver)
+    {
+        // abortS1 = true;
+        // abortS2 = true;
+    }
+}
+
+// copy the game state into the telemetry segment
+static void publish_game(const pipeline_t *pl)
+{
+    telemetry_game_state_t state;
+    unsigned int p;
+
+    memset(&state, 0, sizeof(state));
+    state.level = overload_level(&pl->overload);
+    state.paused = pl->isPaused;
+    state.gameOver = pl->gameOver;
+    state.numPlayers = min(NUM_PLAYERS, TELEMETRY_MAX_PLAYERS);
+    for (p = 0; p < state.numPlayers; p++) {
+        state.scores[p] = pl->players[p].score;
+        if (pl->players[p].joined) {
+            state.joined |= 1u << p;
+        }
+    }
+
+    telemetry_game(pl->telemetry, &state);
+}
+
+//laser tracking and collision detection service
+void *Service_2(void *threadp)
+{
+    unsigned long long S2Cnt = 0;
+    uint64_t jobStart, response, frameTime;
+    plog_t *curr;
+    fault_count_t warmFaults;
+
+    threadParams_t *threadParams = (threadParams_t *)threadp;
+    pipeline_t *pl = threadParams->pipeline;
+
+    prefault_stack(WARMUP_STACK_BYTES);
+    perfctr_open_thread();
+    evlog_register(pl->names[1]);
+
+    if (debug) {
+        evlog(evlog_s2_start);
+    }
+
+    tracking_scratch_t scratch;
+
+    // a laser can move at most a quarter of the frame between tracking jobs
+    Tracker tracker(NUM_PLAYERS, TRACKING_GATE, TRACKING_MAX_MISSES);
+
+    // blank masks exercise every quality level without touching the game
+    Mat red, motion;
+    for (unsigned int i = 0; i < WARMUP_JOBS; i++) {
+        red = Mat::zeros(VIDEO_HEIGHT, VIDEO_WIDTH, CV_8UC1);
+        motion = Mat::zeros(VIDEO_HEIGHT, VIDEO_WIDTH, CV_8UC1);
+        detect_lasers(red, motion, (quality_level_t)(i % quality_num_levels),
+                      tracking_roi(pl, red.size()), pl->detect, scratch);
+        locate_lasers(scratch);
+    }
+
+    if (enter_deadline_mode(&threadParams->deadline) < 0) {
+        perror("Service_2 SCHED_DEADLINE");
+    }
+    if (budget_start(&pl->budgets[1]) < 0) {
+        perror("Service_2 budget timer");
+    }
+
+    get_thread_faults(&warmFaults);
+    pl->readyTime[1] = telemetry_now();
+    sem_post(pl->ready);
+
+    while (!pl->abort[1]) {
+        sem_wait(&pl->release[1]);
+        getStartPlog(&pl->trace, &curr, pipeline_plog_id(pl, 2));
+        budget_arm(&pl->budgets[1]);
+        jobStart = telemetry_now();
+        S2Cnt++;
+        frameTime = pl->frameTime;
+
+        detect_lasers(pl->rsrc, pl->sub, overload_level(&pl->overload),
+                      tracking_roi(pl, pl->rsrc.size()), pl->detect, scratch);
+
+        // a job that used up its budget in detection drops this frame
+        // rather than run on demoted
+        if(!pl->isPaused && !budget_exhausted(&pl->budgets[1])){
+            locate_lasers(scratch);
+            update_game(pl, tracker, scratch.center, frameTime);
+        }
+        publish_game(pl);
+
+        if (debug) {
+            evlog(evlog_s2_release, S2Cnt);
+        }
+
+        budget_complete(&pl->budgets[1]);
+
+        response = overload_complete(&pl->overload, 2);
+        telemetry_job(pl->telemetry, 2, telemetry_now() - jobStart, response);
+        endPlog(curr);
+    }
+
+    budget_stop(&pl->budgets[1]);
+    print_steady_faults(pl->names[1], &warmFaults);
+    perfctr_close_thread();
+    pthread_exit((void *)0);
+}
+
+// draw the game over a copy of frame at the tracking resolution, scaling
+// for display is left to the caller. Players are drawn where their lasers
+// are predicted to be when the frame is seen, not where they were when
+// last tracked.
+static void render_frame(const pipeline_t *pl, const Mat &frame, Mat &disp,
+                         SpriteAtlas &atlas)
+{
+    uint64_t displayTime = telemetry_now() + pl->displayLatency;
+    Player shown[NUM_PLAYERS];
+
+    frame.copyTo(disp);
+
+    for (unsigned int i = 0; i < NUM_PLAYERS; i++) {
+        shown[i] = pl->players[i];
+        if (pl->tracks[i].active && pl->tracks[i].time) {
+            shown[i].reposition(track_predict(pl->tracks[i], displayTime));
+        }
+    }
+
+    if (NUM_PLAYERS == 1) {
+        write_ui(disp, pl->players[0].score);
+    } else {
+        for (unsigned int i = 0; i < NUM_PLAYERS; i++) {
+            write_player_ui(disp, i, pl->players[i].score);
+        }
+    }
+    draw_goals(disp, &pl->goal, 1, atlas);
+    draw_obstacles(disp, pl->obstacles, NUM_OBS, atlas);
+    draw_players(disp, shown, NUM_PLAYERS, atlas);
+
+    if(pl->gameOver)
+    {
+      // putText(disp, "Game Over", Point(VIDEO_WIDTH/4, VIDEO_HEIGHT/3), FONT_HERSHEY_COMPLEX_SMALL, 1,
+      //       Scalar(100, 100, 100), 1, CV_AA);
+    }
+    else if (pl->isPaused)
+    {
+        write_status(disp, "Game Paused", Point(VIDEO_WIDTH/4, VIDEO_HEIGHT/3));
+    }
+
+    // if (detect_collision(goal, o)) {
+    //     putText(disp, "Collision!", Point(40, 40), FONT_HERSHEY_COMPLEX_SMALL, 5,
+    //             Scalar(100, 100, 100), 1, CV_AA);
+    // }
+}
+
+//rendering service
+void *Service_3(void *threadp)
+{
+    unsigned long long S3Cnt = 0;
+    uint64_t jobStart, response;
+    plog_t *curr;
+    fault_count_t warmFaults;
+
+    threadParams_t *threadParams = (threadParams_t *)threadp;
+    pipeline_t *pl = threadParams->pipeline;
+
+    prefault_stack(WARMUP_STACK_BYTES);
+    perfctr_open_thread();
+    evlog_register(pl->names[2]);
+
+    if (debug) {
+        evlog(evlog_s3_start);
+    }
+
+    Mat canvas, disp;
+    cvNamedWindow(pl->window);
+    if (pl->fullscreen) {
+        setWindowProperty(pl->window, CV_WND_PROP_FULLSCREEN,
+                          CV_WINDOW_FULLSCREEN);
+    }
+
+    // pre-render every overlay sprite so the loop only blits
+    SpriteAtlas atlas;
+    init_ui();
+    pl->goal.prepare(atlas);
+    for (unsigned int i = 0; i < NUM_OBS; i++) {
+        pl->obstacles[i].prepare(atlas);
+    }
+    for (unsigned int i = 0; i < NUM_PLAYERS; i++) {
+        pl->players[i].prepare(atlas);
+    }
+
+    Mat blank = Mat::zeros(VIDEO_HEIGHT, VIDEO_WIDTH, CV_8UC3);
+    for (unsigned int i = 0; i < WARMUP_JOBS; i++) {
+        render_frame(pl, blank, canvas, atlas);
+        resize(canvas, disp, Size(), DISPLAY_SCALE, DISPLAY_SCALE);
+    }
+
+    if (enter_deadline_mode(&threadParams->deadline) < 0) {
+        perror("Service_3 SCHED_DEADLINE");
+    }
+    if (budget_start(&pl->budgets[2]) < 0) {
+        perror("Service_3 budget timer");
+    }
+
+    get_thread_faults(&warmFaults);
+    pl->readyTime[2] = telemetry_now();
+    sem_post(pl->ready);
+
+    while (!pl->abort[2]) {
+        sem_wait(&pl->release[2]);
+        getStartPlog(&pl->trace, &curr, pipeline_plog_id(pl, 3));
+        budget_arm(&pl->budgets[2]);
+        jobStart = telemetry_now();
+        S3Cnt++;
+
+        if ((overload_level(&pl->overload) >= quality_half_render) &&
+                ((S3Cnt % 2) == 0)) {
+            budget_complete(&pl->budgets[2]);
+            response = overload_complete(&pl->overload, 3);
+            telemetry_job(pl->telemetry, 3, telemetry_now() - jobStart, response);
+            endPlog(curr);
+            continue;
+        }
+
+        render_frame(pl, pl->src, canvas, atlas);
+        resize(canvas, disp, Size(), DISPLAY_SCALE, DISPLAY_SCALE);
+
+        archive_frame(&pl->archive, archive_rendered, canvas, S3Cnt,
+                      telemetry_now());
+
+        // spectators get the unscaled frame, the hand over never blocks
+        // and gives back another buffer to render into
+        spectator_publish(&pl->spectator, canvas);
+
+        if (!disp.empty()) {
+            imshow(pl->window, disp);
+            int c = cvWaitKey(10);
+            //If 'ESC' is pressed, break the loop
+            if ((char)c == 27 ) {
+                break;
+            }
+
+            // cvWaitKey has painted it, main logs the time to first frame
+            if (!pl->shownTime) {
+                __atomic_store_n(&pl->shownTime, telemetry_now(),
+                                 __ATOMIC_RELEASE);
+                sem_post(pl->shown);
+            }
+        }
+
+        if (debug) {
+            evlog(evlog_s3_release, S3Cnt);
+        }
+
+        budget_complete(&pl->budgets[2]);
+
+        response = overload_complete(&pl->overload, 3);
+        telemetry_job(pl->telemetry, 3, telemetry_now() - jobStart, response);
+        endPlog(curr);
+    }
+
+    budget_stop(&pl->budgets[2]);
+    print_steady_faults(pl->names[2], &warmFaults);
+    perfctr_close_thread();
+    cvDestroyWindow(pl->window);
+    pthread_exit((void *)0);
+}
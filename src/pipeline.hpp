@@ -0,0 +1,151 @@
+/**
+   \file pipeline.hpp
+
+   One capture, track and render pipeline per camera.
+ */
+
+/*
+** Copyright 2018 Benjamin J. Andre.
+** All Rights Reserved.
+**
+** This Source Code Form is subject to the terms of the Mozilla
+** Public License, v. 2.0. If a copy of the MPL was not distributed
+** with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*/
+
+#ifndef RTES_PIPELINE_H_
+#define RTES_PIPELINE_H_
+
+#include <stdint.h>
+
+#include <sched.h>
+#include <semaphore.h>
+
+#include <opencv2/opencv.hpp>
+
+#include "archive.hpp"
+#include "budget.hpp"
+#include "capture.hpp"
+#include "detect.hpp"
+#include "frame_source.hpp"
+#include "gameobjects.hpp"
+#include "overload.hpp"
+#include "plog.hpp"
+#include "release_table.hpp"
+#include "sequencer.hpp"
+#include "spectator.hpp"
+#include "telemetry.hpp"
+#include "tracker.hpp"
+
+static const unsigned int MAX_PIPELINES = 4u;
+
+static const unsigned int VIDEO_WIDTH = 320;
+static const unsigned int VIDEO_HEIGHT = 240;
+
+// one player per laser, up to MAX_TRACKS
+static const unsigned int NUM_PLAYERS = 1;
+static const unsigned int NUM_OBS = 1;
+
+// farthest a laser can move between tracking jobs, a quarter of the frame,
+// and the jobs a track survives without a detection
+static const float TRACKING_GATE = VIDEO_WIDTH / 4.0f;
+static const unsigned int TRACKING_MAX_MISSES = 3;
+
+// locked and prefaulted on every RT thread before it starts
+static const size_t WARMUP_STACK_BYTES = 256u * 1024u;
+
+/**
+   plog ids of pipeline p are service + p * PIPELINE_PLOG_STRIDE, so the
+   first pipeline keeps ids 1 to 3.
+ */
+static const uint32_t PIPELINE_PLOG_STRIDE = 4u;
+
+/** plog ids the sequencer and the services of every pipeline can have */
+static const uint32_t MAX_THREAD_PLOG_IDS =
+    1u + PIPELINE_PLOG_STRIDE * MAX_PIPELINES;
+
+static const size_t PIPELINE_NAME_LEN = 32u;
+
+/**
+   plog id of player prediction events, one per tracked detection. The arg
+   column holds error | (horizon << 16) | (player << 24), the distance
+   between the detection and the position predicted for its capture time
+   in 1/8 pixels and the time since the previous detection in ms.
+ */
+static const uint32_t PLOG_ID_PREDICTION = 17u;
+
+/** default time from rendering a frame to it being seen */
+static const uint64_t DISPLAY_LATENCY_NSEC = 30000000u;
+
+/**
+   Everything one play area needs. Service i of the pipeline waits on
+   release[i], which the sequencer posts through group.
+ */
+struct pipeline_t_ {
+    unsigned int id;
+    frame_source_config_t source;
+    bool pinned;            /*!< services restricted to cpus */
+    cpu_set_t cpus;
+    cpu_set_t captureCpus;  /*!< background cpus of the capture thread */
+
+    sem_t release[NUM_SERVICES];
+    int abort[NUM_SERVICES];
+    release_group_t group;
+    overload_t overload;
+    budget_t budgets[NUM_SERVICES]; /*!< CPU time per job of each service */
+    telemetry_t *telemetry; /*!< NULL unless this pipeline is published */
+    plog_buffer_t trace;
+    sem_t *ready;           /*!< posted by each service after warm-up */
+    sem_t *shown;           /*!< posted once the first frame is displayed */
+    uint64_t readyTime[NUM_SERVICES]; /*!< when each service posted ready */
+    uint64_t shownTime;     /*!< when the first frame was displayed, 0 before */
+
+    char names[NUM_SERVICES][PIPELINE_NAME_LEN];
+    char window[PIPELINE_NAME_LEN];
+    bool fullscreen;
+    spectator_t spectator;  /*!< rendered frames for local spectators */
+    archive_t archive;      /*!< camera and rendered frames saved to disk */
+    capture_t capture;      /*!< frames read by a thread of their own */
+
+    // latest frame, red channel, background model and motion mask
+    detect_params_t detect;
+    cv::Mat src, rsrc, acc, accScaled, sub;
+    uint64_t frameTime;     /*!< capture time of rsrc and sub, ns */
+
+    // motion of each player's laser, extrapolated by the renderer to
+    // displayLatency after it starts drawing
+    track_t tracks[NUM_PLAYERS];
+    uint64_t displayLatency;
+
+    Player players[NUM_PLAYERS];
+    Goal goal;
+    Obstacle obstacles[NUM_OBS];
+    bool goalCollision, gameOver, isPaused;
+};
+
+typedef struct pipeline_t_ pipeline_t;
+
+/**
+   Set up the state, semaphores and trace of a pipeline. Called before any
+   of its threads start. Each service posts ready once it can be released,
+   and the renderer posts shown after it displays its first frame.
+
+   \return 0 on success, -1 with errno set
+ */
+int pipeline_init(pipeline_t *pl, unsigned int id,
+                  const frame_source_config_t &source, telemetry_t *telemetry,
+                  sem_t *ready, sem_t *shown);
+
+/**
+   plog id of service (1 to NUM_SERVICES) of a pipeline
+ */
+uint32_t pipeline_plog_id(const pipeline_t *pl, uint32_t service);
+
+/**
+   Service threads, threadParams_t::pipeline selects the instance
+ */
+void *Service_1(void *threadp);
+void *Service_2(void *threadp);
+void *Service_3(void *threadp);
+
+#endif /* RTES_PIPELINE_H_ */
@@ -1,6 +1,8 @@
 #include "plog.hpp"
+#include <sched.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 int startPlog(plog_t* log, uint32_t id)
 {
@@ -10,6 +12,12 @@ int startPlog(plog_t* log, uint32_t id)
 	}
 
 	log->id = id;
+	log->arg = 0;
+	if(perfctr_read(log->counters))
+	{
+		memset(log->counters, 0, sizeof(log->counters));
+	}
+	log->cpu = sched_getcpu();
 	clock_gettime(CLOCK_REALTIME, &(log->start));
 	return 0;
 }
@@ -21,6 +29,24 @@ int getStartPlog(plog_buffer_t *buff, plog_t **log, uint32_t id)
 	return 0;
 }
 
+int eventPlog(plog_buffer_t *buff, uint32_t id, uint32_t arg)
+{
+	plog_t *log;
+
+	if(getPlog(buff, &log))
+	{
+		return -1;
+	}
+
+	log->id = id;
+	log->arg = arg;
+	memset(log->counters, 0, sizeof(log->counters));
+	log->cpu = sched_getcpu();
+	clock_gettime(CLOCK_REALTIME, &(log->start));
+	log->end = log->start;
+	return 0;
+}
+
 int endPlog(plog_t *log)
 {	
 	if(!log)
@@ -28,14 +54,27 @@ int endPlog(plog_t *log)
 		return -1;
 	}
 
+	uint64_t counters[perfctr_num];
+	int i;
+
 	clock_gettime(CLOCK_REALTIME, &(log->end));
+
+	if(!perfctr_read(counters))
+	{
+		for(i = 0; i < perfctr_num; i++)
+		{
+			log->counters[i] = counters[i] - log->counters[i];
+		}
+	}
 	return 0;
 }
 
 int getPlog(plog_buffer_t *buff, plog_t **log)
 {
-	//not garunteed atomic but close
-	*log = (buff->current)++;
+	//claim the slot atomically, services of a pipeline log in parallel
+	//on multi-core partitions. gcc adds bytes to pointers, not elements
+	*log = __atomic_fetch_add(&(buff->current), sizeof(plog_t),
+		__ATOMIC_RELAXED);
 
 	if(*log > buff->last)
 	{
@@ -68,7 +107,12 @@ int initPlogBuff(size_t size, plog_buffer_t *buff)
 
 int printPlog(plog_t *log)
 {
-	printf("%d, %ld.%09ld, %ld.%09ld\n", log->id, (log->start).tv_sec, (log->start).tv_nsec, (log->end).tv_sec, (log->end).tv_nsec);
+	printf("%d, %ld.%09ld, %ld.%09ld, %u", log->id, (log->start).tv_sec, (log->start).tv_nsec, (log->end).tv_sec, (log->end).tv_nsec, log->arg);
+	for(int i = 0; i < perfctr_num; i++)
+	{
+		printf(", %llu", (unsigned long long)log->counters[i]);
+	}
+	printf(", %d\n", log->cpu);
 	return 0;
 }
 
@@ -96,7 +140,12 @@ int printPlogBuff(plog_buffer_t *buff)
 
 int csvAppendNPlog(plog_t *log, FILE *f)
 {
-	fprintf(f,"%d, %ld.%09ld, %ld.%09ld\n", log->id, (log->start).tv_sec, (log->start).tv_nsec, (log->end).tv_sec, (log->end).tv_nsec);
+	fprintf(f,"%d, %ld.%09ld, %ld.%09ld, %u", log->id, (log->start).tv_sec, (log->start).tv_nsec, (log->end).tv_sec, (log->end).tv_nsec, log->arg);
+	for(int i = 0; i < perfctr_num; i++)
+	{
+		fprintf(f, ", %llu", (unsigned long long)log->counters[i]);
+	}
+	fprintf(f, ", %d\n", log->cpu);
 	return 0;
 }
 
@@ -5,11 +5,19 @@
 #include <stddef.h>
 #include <time.h>
 
+#include "perfctr.hpp"
+
 typedef struct
 {
 	uint32_t id;
 	struct timespec start;
 	struct timespec end;
+	uint32_t arg; // event specific detail, 0 for job records
+	// perfctr_t counts between start and end, zero unless counting is
+	// enabled on the recording thread
+	uint64_t counters[perfctr_num];
+	// cpu the record was started on, -1 if unknown
+	int32_t cpu;
 
 } plog_t;
 
@@ -37,6 +45,9 @@ int initPlogBuff(size_t size, plog_buffer_t *buff);
 
 int getStartPlog(plog_buffer_t *buff, plog_t **log, uint32_t id);
 
+// record an instantaneous event, start and end are both the current time
+int eventPlog(plog_buffer_t *buff, uint32_t id, uint32_t arg);
+
 int printPlog(plog_t *log);
 
 int printPlogBuff(plog_buffer_t *buff);
@@ -0,0 +1,217 @@
+/**
+   \file release_table.hpp
+
+   Cyclic executive release table computed at compile time from the
+   service set.
+ */
+
+/*
+** Copyright 2018 Benjamin J. Andre.
+** All Rights Reserved.
+**
+** This Source Code Form is subject to the terms of the Mozilla
+** Public License, v. 2.0. If a copy of the MPL was not distributed
+** with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*/
+
+#ifndef RTES_RELEASE_TABLE_H_
+#define RTES_RELEASE_TABLE_H_
+
+#include <stdint.h>
+
+#include "constants.hpp"
+
+/**
+   A periodic task released by the sequencer.
+ */
+typedef struct {
+    uint32_t periodTicks;  /*!< sequencer ticks between releases */
+    uint32_t budgetUsec;   /*!< execution time budget of the analysis */
+    uint32_t wcetUsec;     /*!< measured worst execution time */
+} service_spec_t;
+
+/**
+   The services released by the sequencer, in rate monotonic priority order.
+   Service i of the table is released on semaphore S<i+1>.
+ */
+static constexpr service_spec_t SERVICE_SET[] = {
+    {S1_PERIOD_TICKS, S1_BUDGET_USEC, S1_WCET_USEC},
+    {S2_PERIOD_TICKS, S2_BUDGET_USEC, S2_WCET_USEC},
+    {S3_PERIOD_TICKS, S3_BUDGET_USEC, S3_WCET_USEC},
+};
+
+static constexpr unsigned int NUM_SERVICES =
+    sizeof(SERVICE_SET) / sizeof(SERVICE_SET[0]);
+
+/** keeps the table small enough to stay in cache */
+static constexpr uint32_t MAX_HYPERPERIOD_TICKS = 1024u;
+
+constexpr uint64_t gcd(uint64_t a, uint64_t b)
+{
+    return (b == 0) ? a : gcd(b, a % b);
+}
+
+constexpr uint64_t hyperperiod(unsigned int n = NUM_SERVICES)
+{
+    return (n == 0) ? 1 : (hyperperiod(n - 1) / gcd(hyperperiod(n - 1),
+                           SERVICE_SET[n - 1].periodTicks)) *
+           SERVICE_SET[n - 1].periodTicks;
+}
+
+static constexpr uint32_t HYPERPERIOD_TICKS = (uint32_t)hyperperiod();
+
+/**
+   Bit i of releases[t] is set when service i is released on tick t of the
+   hyperperiod.
+ */
+typedef struct {
+    uint32_t releases[HYPERPERIOD_TICKS];
+} release_table_t;
+
+constexpr release_table_t make_release_table()
+{
+    release_table_t table = {};
+    uint32_t t = 0;
+    unsigned int i = 0;
+
+    for (t = 0; t < HYPERPERIOD_TICKS; t++) {
+        for (i = 0; i < NUM_SERVICES; i++) {
+            if (t % SERVICE_SET[i].periodTicks == 0) {
+                table.releases[t] |= 1u << i;
+            }
+        }
+    }
+    return table;
+}
+
+static constexpr release_table_t RELEASE_TABLE = make_release_table();
+
+/**
+   Release mask of sequencer cycle seqCnt, counting from 1 like the
+   sequencer.
+ */
+inline uint32_t releases_at(unsigned long long seqCnt)
+{
+    return RELEASE_TABLE.releases[seqCnt % HYPERPERIOD_TICKS];
+}
+
+//
+// static schedulability checks, a configuration that fails them does not
+// build
+//
+
+constexpr uint64_t tick_ns()
+{
+    return SEQUENCER_PERIOD_NSEC;
+}
+
+constexpr uint64_t period_ns(unsigned int i)
+{
+    return (uint64_t)SERVICE_SET[i].periodTicks * tick_ns();
+}
+
+constexpr uint64_t budget_ns(unsigned int i)
+{
+    return (uint64_t)SERVICE_SET[i].budgetUsec * 1000u;
+}
+
+/**
+   CPU time per job a service is demoted after, its measured WCET with a
+   margin so that only jobs beyond anything measured are cut short
+ */
+constexpr uint64_t enforced_budget_ns(unsigned int i)
+{
+    return (uint64_t)SERVICE_SET[i].wcetUsec * 1000u *
+           ENFORCE_MARGIN_PERCENT / 100u;
+}
+
+constexpr bool rate_monotonic_order()
+{
+    unsigned int i = 0;
+    for (i = 1; i < NUM_SERVICES; i++) {
+        if (SERVICE_SET[i].periodTicks < SERVICE_SET[i - 1].periodTicks) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+   Demand of the sequencer and all services over one hyperperiod fits in
+   the cores.
+ */
+constexpr bool utilization_feasible()
+{
+    uint64_t hyper = HYPERPERIOD_TICKS * tick_ns();
+    uint64_t demand = HYPERPERIOD_TICKS * (uint64_t)SEQUENCER_BUDGET_USEC *
+                      1000u;
+    unsigned int i = 0;
+
+    for (i = 0; i < NUM_SERVICES; i++) {
+        demand += (HYPERPERIOD_TICKS / SERVICE_SET[i].periodTicks) *
+                  budget_ns(i);
+    }
+    return demand <= NUM_CPU_CORES * hyper;
+}
+
+/**
+   Worst case response time of service i under fixed priority preemptive
+   scheduling on one core, interfered with by the sequencer and every
+   higher priority service. Stops once the period is exceeded.
+ */
+constexpr uint64_t response_time(unsigned int i)
+{
+    uint64_t r = budget_ns(i), next = 0;
+    unsigned int j = 0;
+
+    while (r <= period_ns(i)) {
+        next = budget_ns(i) + ((r + tick_ns() - 1) / tick_ns()) *
+               (uint64_t)SEQUENCER_BUDGET_USEC * 1000u;
+        for (j = 0; j < i; j++) {
+            next += ((r + period_ns(j) - 1) / period_ns(j)) * budget_ns(j);
+        }
+        if (next == r) {
+            break;
+        }
+        r = next;
+    }
+    return r;
+}
+
+constexpr bool response_times_feasible()
+{
+    unsigned int i = 0;
+    for (i = 0; i < NUM_SERVICES; i++) {
+        if (response_time(i) > period_ns(i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+constexpr bool enforced_budgets_fit()
+{
+    unsigned int i = 0;
+    for (i = 0; i < NUM_SERVICES; i++) {
+        if (enforced_budget_ns(i) < budget_ns(i) ||
+                enforced_budget_ns(i) > period_ns(i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static_assert(HYPERPERIOD_TICKS <= MAX_HYPERPERIOD_TICKS,
+              "service periods give a hyperperiod too long for the table");
+static_assert(NUM_SERVICES <= 32u, "release masks hold at most 32 services");
+static_assert(rate_monotonic_order(),
+              "SERVICE_SET must be ordered by period, shortest first");
+static_assert(utilization_feasible(),
+              "service budgets exceed the available CPU utilization");
+static_assert(NUM_CPU_CORES > 1 || response_times_feasible(),
+              "a service misses its deadline in response time analysis");
+static_assert(enforced_budgets_fit(),
+              "enforced budgets must lie between the analysis budget and "
+              "the period");
+
+#endif /* RTES_RELEASE_TABLE_H_ */
@@ -105,133 +105,163 @@
 #include "thread_context.hpp"
 
 #include "plog.hpp"
+#include "overload.hpp"
+#include "perfctr.hpp"
+#include "telemetry.hpp"
+#include "evlog.hpp"
+#include "executor.hpp"
+#include "release_table.hpp"
 
-static const int MAX_MSG_LEN = 1024;
 static const bool debug = false;
 
-extern int abortS1;
-extern sem_t semS1;
-extern int abortS2;
-extern sem_t semS2;
-extern int abortS3;
-extern sem_t semS3;
 extern struct timeval start_time_val;
+extern telemetry_t *telemetry;
 
 int abortTest = false;
 
 void *sequencer(void *context)
 {
-    struct timeval current_time_val;
-    struct timespec delay_time = {0, 33333333}; // delay for 33.33 msec, 30 Hz
+    struct timespec delay_time = {0, SEQUENCER_PERIOD_NSEC}; // 33.33 msec, 30 Hz
     struct timespec remaining_time;
+    struct timespec next_release;
     double residual;
     int rc, delay_cnt = 0;
     unsigned long long seqCnt = 0;
+    uint64_t jobStart, jobTime;
+    uint32_t releases;
+    unsigned int g, i;
     threadParams_t *threadParams = (threadParams_t *)context;
 
     plog_buffer_t buff;
     plog_t *curr;
 
-    initPlogBuff(10000, &buff);
+    // one record per cycle, so a whole session fits
+    initPlogBuff(threadParams->sequencePeriods > 10000 ?
+                 threadParams->sequencePeriods + 1 : 10000, &buff);
 
-    char message[MAX_MSG_LEN];
+    if (enter_deadline_mode(&threadParams->deadline) < 0) {
+        perror("Sequencer SCHED_DEADLINE");
+    }
 
-    gettimeofday(&current_time_val, (struct timezone *)0);
-    syslog(LOG_CRIT, "Sequencer thread @ sec=%d, msec=%d\n",
-           (int)(current_time_val.tv_sec - start_time_val.tv_sec),
-           (int)current_time_val.tv_usec / USEC_PER_MSEC);
-    printf("Sequencer thread @ sec=%d, msec=%d\n",
-           (int)(current_time_val.tv_sec - start_time_val.tv_sec),
-           (int)current_time_val.tv_usec / USEC_PER_MSEC);
+    perfctr_open_thread();
+
+    evlog_register("Sequencer");
+    evlog(evlog_seq_start);
+
+    // absolute releases are a fixed grid from here, so they do not drift by
+    // the time each cycle takes the way relative sleeps do
+    clock_gettime(CLOCK_MONOTONIC, &next_release);
 
     do {
         delay_cnt = 0;
         residual = 0.0;
 
-        gettimeofday(&current_time_val, (struct timezone *)0);
-        snprintf(message, MAX_MSG_LEN,
-                 "Sequencer thread prior to delay @ sec=%d, msec=%d\n",
-                 (int)(current_time_val.tv_sec - start_time_val.tv_sec),
-                 (int)current_time_val.tv_usec / USEC_PER_MSEC);
-        syslog(LOG_CRIT, "%s", message);
-        if (debug) {
-            printf("%s", message);
-        }
-        do {
-            rc = nanosleep(&delay_time, &remaining_time);
-
-            if (rc == EINTR) {
-                residual = remaining_time.tv_sec + ((double)remaining_time.tv_nsec /
-                                                    (double)NANOSEC_PER_SEC);
-
-                if (residual > 0.0) {
-                    printf("residual=%lf, sec=%d, nsec=%d\n", residual, (int)remaining_time.tv_sec,
-                           (int)remaining_time.tv_nsec);
-                }
-
+        evlog(evlog_seq_delay);
+        if (threadParams->sleep == sequencer_absolute) {
+            next_release.tv_nsec += SEQUENCER_PERIOD_NSEC;
+            if (next_release.tv_nsec >= (long)NANOSEC_PER_SEC) {
+                next_release.tv_nsec -= NANOSEC_PER_SEC;
+                next_release.tv_sec++;
+            }
+            do {
+                rc = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME,
+                                     &next_release, NULL);
                 delay_cnt++;
-            } else if (rc < 0) {
-                perror("Sequencer nanosleep");
+            } while (rc == EINTR && delay_cnt < 100);
+            if (rc != 0 && rc != EINTR) {
+                errno = rc;
+                perror("Sequencer clock_nanosleep");
                 exit(-1);
             }
+        } else {
+            do {
+                rc = nanosleep(&delay_time, &remaining_time);
+
+                if (rc == EINTR) {
+                    residual = remaining_time.tv_sec + ((double)remaining_time.tv_nsec /
+                                                        (double)NANOSEC_PER_SEC);
+
+                    if (residual > 0.0) {
+                        evlog(evlog_seq_residual,
+                              (uint64_t)remaining_time.tv_sec * NANOSEC_PER_SEC +
+                              remaining_time.tv_nsec);
+                    }
+
+                    delay_cnt++;
+                } else if (rc < 0) {
+                    perror("Sequencer nanosleep");
+                    exit(-1);
+                }
 
-        } while ((residual > 0.0) && (delay_cnt < 100));
+            } while ((residual > 0.0) && (delay_cnt < 100));
+        }
 
         getStartPlog(&buff, &curr, 0);
+        jobStart = telemetry_now();
 
         seqCnt++;
-        gettimeofday(&current_time_val, (struct timezone *)0);
-        snprintf(message, MAX_MSG_LEN, "Sequencer cycle %llu @ sec=%d, msec=%d\n",
-                 seqCnt,
-                 (int)(current_time_val.tv_sec - start_time_val.tv_sec),
-                 (int)current_time_val.tv_usec / USEC_PER_MSEC);
         if (debug) {
-            printf("%s", message);
+            evlog(evlog_seq_cycle, seqCnt);
         }
 
         if (delay_cnt > 1) {
-            printf("Sequencer looping delay %d\n", delay_cnt);
+            evlog(evlog_seq_looping, delay_cnt);
         }
 
 
-        // Release each service at a sub-rate of the generic sequencer rate
+        // Release each service at a sub-rate of the generic sequencer rate,
+        // the set released on this tick comes from the precomputed table
+        releases = releases_at(seqCnt);
+        for (g = 0; g < threadParams->numGroups; g++) {
+            release_group_t *group = &threadParams->groups[g];
 
-        // Servcie_1 = RT_MAX-1 @ 3 Hz
-        if ((seqCnt % 3) == 0) {
-            sem_post(&semS1);
-        }
+            for (i = 0; i < NUM_SERVICES; i++) {
+                if (releases & (1u << i)) {
+                    unsigned long long violations =
+                        budget_violations(group->budgets[i]);
+
+                    // the service's last job ran over its CPU budget
+                    if (violations != group->violations[i]) {
+                        group->violations[i] = violations;
+                        evlog(evlog_seq_budget, g, i + 1, violations);
+                    }
 
-        // Servcie_1 = RT_MAX-1 @ 3 Hz
-        if ((seqCnt % 4) == 0) {
-            sem_post(&semS2);
+                    overload_release(group->overload, i + 1);
+                    telemetry_release(group->telemetry, i + 1);
+                    sem_post(group->sems[i]);
+                }
+            }
         }
 
-        // Servcie_1 = RT_MAX-1 @ 3 Hz
-        if ((seqCnt % 5) == 0) {
-            sem_post(&semS3);
+        // best effort jobs go to the worker pool, which never blocks the
+        // sequencer and skips a job still pending from its last release
+        for (i = 0; i < threadParams->numJobs; i++) {
+            if ((seqCnt % threadParams->jobs[i].period) == 0) {
+                executor_release(threadParams->executor,
+                                 &threadParams->jobs[i]);
+            }
         }
 
-        gettimeofday(&current_time_val, (struct timezone *)0);
-        snprintf(message, MAX_MSG_LEN,
-                 "Sequencer release all sub-services @ sec=%d, msec=%d\n",
-                 (int)(current_time_val.tv_sec - start_time_val.tv_sec),
-                 (int)current_time_val.tv_usec / USEC_PER_MSEC);
         if (debug) {
-            printf("%s", message);
+            evlog(evlog_seq_released);
         }
 
         endPlog(curr);
+        telemetry_release(telemetry, 0);
+        jobTime = telemetry_now() - jobStart;
+        telemetry_job(telemetry, 0, jobTime, jobTime);
 
     } while (!abortTest && (seqCnt < threadParams->sequencePeriods));
 
-    abortS1 = true;
-    sem_post(&semS1);
-    abortS2 = true;
-    sem_post(&semS2);
-    abortS3 = true;
-    sem_post(&semS3);
+    for (g = 0; g < threadParams->numGroups; g++) {
+        for (i = 0; i < NUM_SERVICES; i++) {
+            *threadParams->groups[g].aborts[i] = true;
+            sem_post(threadParams->groups[g].sems[i]);
+        }
+    }
 
-    csvAppendPlogBuff(&buff, "results.csv");
+    csvAppendPlogBuff(&buff, threadParams->traceFile);
 
+    perfctr_close_thread();
     pthread_exit((void *)0);
 }
@@ -18,6 +18,35 @@
 
 #include <stdint.h>
 
+#include <semaphore.h>
+
+#include "budget.hpp"
+#include "overload.hpp"
+#include "release_table.hpp"
+#include "telemetry.hpp"
+
+/**
+   How the sequencer waits for its next release
+ */
+typedef enum sequencer_sleep_t_ {
+    sequencer_relative = 0, /*!< nanosleep one period after each cycle */
+    sequencer_absolute,     /*!< clock_nanosleep to the next absolute release */
+} sequencer_sleep_t;
+
+/**
+   One set of services released together by the sequencer, e.g. the
+   pipeline of one camera. Service i of SERVICE_SET is released by posting
+   sems[i] and stopped by setting *aborts[i].
+ */
+typedef struct {
+    sem_t *sems[NUM_SERVICES];
+    int *aborts[NUM_SERVICES];
+    overload_t *overload;    /*!< release stamps and quality of the group */
+    telemetry_t *telemetry;  /*!< NULL if the group is not published */
+    budget_t *budgets[NUM_SERVICES];
+    unsigned long long violations[NUM_SERVICES]; /*!< seen by the sequencer */
+} release_group_t;
+
 /**
    Do something interesting
 
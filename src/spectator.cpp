@@ -0,0 +1,317 @@
+
+/*
+** Copyright 2018 Benjamin J. Andre.
+** All Rights Reserved.
+**
+** This Source Code Form is subject to the terms of the Mozilla
+** Public License, v. 2.0. If a copy of the MPL was not distributed
+** with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*/
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <algorithm>
+
+#include "spectator.hpp"
+
+using namespace cv;
+
+static const int LISTEN_BACKLOG = 4;
+
+// whole frames a spectator's socket buffers, the default buffer does not
+// even hold one key frame at 320x240
+static const int BUFFERED_FRAMES = 4;
+
+static void accept_clients(spectator_t *sp)
+{
+    int fd;
+
+    while ((fd = accept4(sp->listenFd, NULL, NULL,
+                         SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+        if (sp->numClients == SPECTATOR_MAX_CLIENTS) {
+            close(fd);
+            continue;
+        }
+        // above wmem_max only with CAP_NET_ADMIN, which the game has as root
+        if (setsockopt(fd, SOL_SOCKET, SO_SNDBUFFORCE, &sp->sendBuffer,
+                       sizeof(sp->sendBuffer)) < 0) {
+            setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &sp->sendBuffer,
+                       sizeof(sp->sendBuffer));
+        }
+
+        // a new spectator has no reference frame yet
+        sp->clients[sp->numClients].fd = fd;
+        sp->clients[sp->numClients].key = true;
+        sp->numClients++;
+    }
+}
+
+static void drop_client(spectator_t *sp, unsigned int i)
+{
+    close(sp->clients[i].fd);
+    sp->clients[i] = sp->clients[--sp->numClients];
+}
+
+static bool tile_changed(const Mat &a, const Mat &b, int x, int y, int w,
+                         int h)
+{
+    size_t bytes = (size_t)w * a.elemSize();
+    int r;
+
+    for (r = y; r < y + h; r++) {
+        if (memcmp(a.ptr<uint8_t>(r) + x * a.elemSize(),
+                   b.ptr<uint8_t>(r) + x * b.elemSize(), bytes) != 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// header and pixels of the tiles of one row selected by columns
+static void encode_row(const spectator_t *sp, unsigned int row,
+                       uint64_t columns, uint16_t flags,
+                       std::vector<uint8_t> &out)
+{
+    const Mat &f = sp->current;
+    spectator_header_t header;
+    int y = row * SPECTATOR_TILE;
+    int h = std::min((int)SPECTATOR_TILE, f.rows - y);
+    unsigned int c;
+
+    memset(&header, 0, sizeof(header));
+    header.magic = SPECTATOR_MAGIC;
+    header.frame = sp->frame;
+    header.width = (uint16_t)f.cols;
+    header.height = (uint16_t)f.rows;
+    header.tile = SPECTATOR_TILE;
+    header.row = (uint16_t)row;
+    header.flags = flags;
+    header.columns = columns;
+
+    out.resize(sizeof(header));
+    memcpy(&out[0], &header, sizeof(header));
+
+    for (c = 0; columns >> c; c++) {
+        int x = c * SPECTATOR_TILE;
+        int w = std::min((int)SPECTATOR_TILE, f.cols - x);
+        size_t bytes = (size_t)w * f.elemSize();
+        int r;
+
+        if (!((columns >> c) & 1u)) {
+            continue;
+        }
+        for (r = y; r < y + h; r++) {
+            const uint8_t *p = f.ptr<uint8_t>(r) + x * f.elemSize();
+            out.insert(out.end(), p, p + bytes);
+        }
+    }
+}
+
+// send without ever waiting, a spectator whose socket is full misses the
+// rest of the frame and gets whole frames until it has caught up
+static void send_row(spectator_t *sp, const std::vector<uint8_t> &msg,
+                     bool key, bool *skip)
+{
+    unsigned int i = 0;
+
+    while (i < sp->numClients) {
+        spectator_client_t *client = &sp->clients[i];
+
+        if (skip[i] || client->key != key) {
+            i++;
+            continue;
+        }
+        if (send(client->fd, &msg[0], msg.size(),
+                 MSG_DONTWAIT | MSG_NOSIGNAL) < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS) {
+                skip[i] = true;
+                sp->resyncs++;
+            } else {
+                drop_client(sp, i);
+                skip[i] = skip[sp->numClients];
+                continue;
+            }
+        }
+        i++;
+    }
+}
+
+static void send_frame(spectator_t *sp)
+{
+    const Mat &f = sp->current;
+    unsigned int rows = (f.rows + SPECTATOR_TILE - 1) / SPECTATOR_TILE;
+    unsigned int cols = (f.cols + SPECTATOR_TILE - 1) / SPECTATOR_TILE;
+    bool all = !sp->reference || sp->previous.size() != f.size() ||
+               sp->previous.type() != f.type();
+    uint64_t full = (cols == 64) ? ~0ull : ((1ull << cols) - 1);
+    bool skip[SPECTATOR_MAX_CLIENTS] = {false};
+    bool anyKey = false;
+    unsigned int row, c, i;
+
+    for (i = 0; i < sp->numClients; i++) {
+        anyKey = anyKey || sp->clients[i].key;
+    }
+
+    for (row = 0; row < rows; row++) {
+        uint16_t flags = (row == rows - 1) ? SPECTATOR_END : 0;
+        uint64_t changed = 0;
+        int y = row * SPECTATOR_TILE;
+        int h = std::min((int)SPECTATOR_TILE, f.rows - y);
+
+        for (c = 0; c < cols && !all; c++) {
+            int x = c * SPECTATOR_TILE;
+            int w = std::min((int)SPECTATOR_TILE, f.cols - x);
+
+            if (tile_changed(f, sp->previous, x, y, w, h)) {
+                changed |= 1ull << c;
+            }
+        }
+
+        // without a reference of the same size every tile is sent anyway
+        if (all) {
+            changed = full;
+            flags |= SPECTATOR_KEY;
+        }
+
+        if (changed || flags) {
+            encode_row(sp, row, changed, flags, sp->delta);
+            send_row(sp, sp->delta, false, skip);
+        }
+        if (anyKey) {
+            encode_row(sp, row, full, flags | SPECTATOR_KEY, sp->key);
+            send_row(sp, sp->key, true, skip);
+        }
+    }
+
+    // a spectator that got every row of a whole frame can take deltas
+    for (i = 0; i < sp->numClients; i++) {
+        sp->clients[i].key = skip[i];
+    }
+    sp->frame++;
+}
+
+void spectator_stream(void *context)
+{
+    spectator_t *sp = (spectator_t *)context;
+    bool fresh;
+
+    if (!sp->running) {
+        return;
+    }
+
+    accept_clients(sp);
+
+    pthread_mutex_lock(&sp->lock);
+    fresh = sp->fresh;
+    if (fresh) {
+        std::swap(sp->latest, sp->current);
+        sp->fresh = false;
+    }
+    pthread_mutex_unlock(&sp->lock);
+
+    if (!fresh || sp->current.empty() ||
+            (sp->current.cols + SPECTATOR_TILE - 1) / SPECTATOR_TILE >
+            SPECTATOR_MAX_COLUMNS) {
+        return;
+    }
+
+    if (sp->numClients > 0) {
+        send_frame(sp);
+    }
+
+    // the frame just sent is the reference for the next one
+    std::swap(sp->current, sp->previous);
+    sp->reference = true;
+}
+
+int spectator_start(spectator_t *sp, const char *path, Size size)
+{
+    struct sockaddr_un addr;
+
+    sp->running = false;
+    sp->fresh = false;
+    sp->reference = false;
+    sp->numClients = 0;
+    sp->frame = 0;
+    sp->published = 0;
+    sp->busy = 0;
+    sp->resyncs = 0;
+
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    snprintf(sp->path, sizeof(sp->path), "%s", path);
+
+    sp->listenFd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK |
+                          SOCK_CLOEXEC, 0);
+    if (sp->listenFd < 0) {
+        return -1;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, sp->path, strlen(sp->path));
+
+    // a socket left behind by a previous session
+    unlink(sp->path);
+    if (bind(sp->listenFd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+            listen(sp->listenFd, LISTEN_BACKLOG) < 0) {
+        close(sp->listenFd);
+        return -1;
+    }
+
+    sp->sendBuffer = BUFFERED_FRAMES * size.width * size.height * 3;
+    sp->latest.create(size, CV_8UC3);
+    sp->current.create(size, CV_8UC3);
+    sp->previous.create(size, CV_8UC3);
+
+    pthread_mutex_init(&sp->lock, NULL);
+
+    sp->running = true;
+    return 0;
+}
+
+void spectator_publish(spectator_t *sp, Mat &frame)
+{
+    if (!sp->running) {
+        return;
+    }
+
+    // the stream job only holds the lock to swap, skipping a frame is
+    // better than waiting for it
+    if (pthread_mutex_trylock(&sp->lock) != 0) {
+        sp->busy++;
+        return;
+    }
+    std::swap(sp->latest, frame);
+    sp->fresh = true;
+    pthread_mutex_unlock(&sp->lock);
+
+    sp->published++;
+}
+
+void spectator_stop(spectator_t *sp)
+{
+    unsigned int i;
+
+    if (!sp->running) {
+        return;
+    }
+
+    for (i = 0; i < sp->numClients; i++) {
+        close(sp->clients[i].fd);
+    }
+    sp->numClients = 0;
+    close(sp->listenFd);
+    unlink(sp->path);
+
+    pthread_mutex_destroy(&sp->lock);
+    sp->running = false;
+}
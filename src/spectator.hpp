@@ -0,0 +1,126 @@
+/**
+   \file spectator.hpp
+
+   Rendered frames streamed to local spectators over a Unix domain socket,
+   as tile deltas against the previous frame.
+ */
+
+/*
+** Copyright 2018 Benjamin J. Andre.
+** All Rights Reserved.
+**
+** This Source Code Form is subject to the terms of the Mozilla
+** Public License, v. 2.0. If a copy of the MPL was not distributed
+** with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*/
+
+#ifndef RTES_SPECTATOR_H_
+#define RTES_SPECTATOR_H_
+
+#include <stdint.h>
+
+#include <pthread.h>
+
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+static const uint32_t SPECTATOR_MAGIC = 0x4c475331u;   // "LGS1"
+
+/** sequencer ticks between runs of the stream job */
+static const unsigned int SPECTATOR_STREAM_PERIOD = 1u;
+
+/** tiles are compared and sent as squares of this many pixels */
+static const unsigned int SPECTATOR_TILE = 16u;
+/** tile columns of a row fit in the header's mask */
+static const unsigned int SPECTATOR_MAX_COLUMNS = 64u;
+static const unsigned int SPECTATOR_MAX_CLIENTS = 8u;
+
+/** the message holds every tile of its row, not only the changed ones */
+static const uint16_t SPECTATOR_KEY = 1u;
+/** last message of a frame */
+static const uint16_t SPECTATOR_END = 2u;
+
+/**
+   One message per tile row of a frame, on a SOCK_SEQPACKET socket so each
+   arrives whole. The header is followed by the BGR pixels of the tiles
+   whose bit is set in columns, lowest column first, each tile row major
+   and clipped at the right and bottom edges. Rows without changes are not
+   sent, except for the last one which always carries SPECTATOR_END.
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t frame;      /*!< counts frames sent by the stream */
+    uint16_t width;
+    uint16_t height;
+    uint16_t tile;       /*!< tile size in pixels */
+    uint16_t row;        /*!< tile row */
+    uint16_t flags;
+    uint16_t reserved;
+    uint64_t columns;    /*!< bit per tile column included */
+} spectator_header_t;
+
+typedef struct {
+    int fd;
+    bool key;            /*!< missed a message, resend whole frames */
+} spectator_client_t;
+
+/**
+   Stream of one pipeline. The renderer hands each frame over with
+   spectator_publish, which never blocks, and spectator_stream, a best
+   effort job, encodes and sends it. Spectators that cannot keep up lose
+   frames, the renderer never waits for them.
+ */
+typedef struct {
+    bool running;
+    char path[108];
+    int listenFd;
+    int sendBuffer;         /*!< SO_SNDBUF of each spectator, bytes */
+
+    // latest frame handed over by the renderer, swapped rather than copied
+    pthread_mutex_t lock;
+    cv::Mat latest;
+    bool fresh;
+
+    // sender side, touched only by the stream job
+    cv::Mat current, previous;
+    bool reference;         /*!< previous holds the last frame sent */
+    std::vector<uint8_t> delta, key;
+    spectator_client_t clients[SPECTATOR_MAX_CLIENTS];
+    unsigned int numClients;
+    uint32_t frame;
+
+    unsigned long long published; /*!< frames handed over */
+    unsigned long long busy;      /*!< frames skipped, the job held the lock */
+    unsigned long long resyncs;   /*!< client sends that would have blocked */
+} spectator_t;
+
+/**
+   Listen on path. The frame buffers are allocated here at size, so
+   handing over frames of that size never allocates.
+
+   \return 0 on success, -1 with errno set
+ */
+int spectator_start(spectator_t *sp, const char *path, cv::Size size);
+
+/**
+   Hand a rendered frame to the stream, called by the renderer. frame is
+   swapped with the previous hand over, so the caller gets back a buffer
+   of unspecified content. Does nothing while the stream job is busy with
+   the previous hand over.
+ */
+void spectator_publish(spectator_t *sp, cv::Mat &frame);
+
+/**
+   Accept new spectators and send the latest frame handed over, if any, an
+   executor job. Must not run concurrently with itself or spectator_stop.
+ */
+void spectator_stream(void *context);
+
+/**
+   Disconnect the spectators and remove the socket, after the last stream
+   job.
+ */
+void spectator_stop(spectator_t *sp);
+
+#endif /* RTES_SPECTATOR_H_ */
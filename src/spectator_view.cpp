@@ -0,0 +1,166 @@
+
+/*
+** Copyright 2018 Benjamin J. Andre.
+** All Rights Reserved.
+**
+** This Source Code Form is subject to the terms of the Mozilla
+** Public License, v. 2.0. If a copy of the MPL was not distributed
+** with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*/
+
+// Watches a running game from the spectator socket given to -S.
+//
+// Applies the tiles of each message to its copy of the frame and shows the
+// frame once its last row arrives. It runs at any priority, the game drops
+// frames for a slow spectator rather than wait for it.
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <getopt.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "spectator.hpp"
+
+using namespace cv;
+
+static const double DEFAULT_SCALE = 2.5;
+
+static void usage(const char *name)
+{
+    printf("usage: %s [-z scale] socket\n", name);
+    printf("  -z  window scale (default %.1f)\n", DEFAULT_SCALE);
+}
+
+static int connect_socket(const char *path)
+{
+    struct sockaddr_un addr;
+    int fd;
+
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+
+    fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, path, strlen(path));
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// copy the tiles of one message into frame, false if it is malformed
+static bool apply_row(const uint8_t *msg, size_t len, Mat &frame)
+{
+    spectator_header_t header;
+    size_t offset = sizeof(header);
+    unsigned int c;
+
+    memcpy(&header, msg, sizeof(header));
+    if (header.magic != SPECTATOR_MAGIC || header.tile == 0) {
+        return false;
+    }
+
+    frame.create(header.height, header.width, CV_8UC3);
+
+    int y = header.row * header.tile;
+    int h = std::min((int)header.tile, frame.rows - y);
+    for (c = 0; c < SPECTATOR_MAX_COLUMNS; c++) {
+        int x = c * header.tile;
+        int w = std::min((int)header.tile, frame.cols - x);
+        size_t bytes = (size_t)w * frame.elemSize();
+        int r;
+
+        if (!((header.columns >> c) & 1u)) {
+            continue;
+        }
+        if (w <= 0 || h <= 0 || offset + bytes * h > len) {
+            return false;
+        }
+        for (r = y; r < y + h; r++) {
+            memcpy(frame.ptr<uint8_t>(r) + x * frame.elemSize(), msg + offset,
+                   bytes);
+            offset += bytes;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    double scale = DEFAULT_SCALE;
+    std::vector<uint8_t> msg(sizeof(spectator_header_t) +
+                             SPECTATOR_MAX_COLUMNS * SPECTATOR_TILE *
+                             SPECTATOR_TILE * 3);
+    spectator_header_t header;
+    unsigned long long frames = 0;
+    Mat frame, shown;
+    ssize_t len;
+    int fd, opt;
+
+    while ((opt = getopt(argc, argv, "z:h")) != -1) {
+        switch (opt) {
+        case 'z':
+            scale = atof(optarg);
+            break;
+        case 'h':
+            usage(argv[0]);
+            exit(0);
+        default:
+            usage(argv[0]);
+            exit(-1);
+        }
+    }
+    if (optind >= argc || scale <= 0.0) {
+        usage(argv[0]);
+        exit(-1);
+    }
+
+    fd = connect_socket(argv[optind]);
+    if (fd < 0) {
+        perror(argv[optind]);
+        exit(-1);
+    }
+
+    namedWindow(argv[optind]);
+
+    while ((len = recv(fd, &msg[0], msg.size(), 0)) > 0) {
+        if ((size_t)len < sizeof(header) ||
+                !apply_row(&msg[0], (size_t)len, frame)) {
+            fprintf(stderr, "malformed message of %zd bytes\n", len);
+            continue;
+        }
+
+        memcpy(&header, &msg[0], sizeof(header));
+        if (header.flags & SPECTATOR_END) {
+            resize(frame, shown, Size(), scale, scale, INTER_NEAREST);
+            imshow(argv[optind], shown);
+            frames++;
+            if ((char)waitKey(1) == 27) {
+                break;
+            }
+        }
+    }
+
+    printf("%llu frames\n", frames);
+    close(fd);
+    return 0;
+}
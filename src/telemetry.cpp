@@ -0,0 +1,213 @@
+
+/*
+** Copyright 2018 Benjamin J. Andre.
+** All Rights Reserved.
+**
+** This Source Code Form is subject to the terms of the Mozilla
+** Public License, v. 2.0. If a copy of the MPL was not distributed
+** with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "constants.hpp"
+#include "telemetry.hpp"
+
+telemetry_t *telemetry_create(void)
+{
+    telemetry_t *t;
+    int fd;
+
+    fd = shm_open(TELEMETRY_NAME, O_CREAT | O_RDWR, 0644);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    if (ftruncate(fd, sizeof(telemetry_t)) < 0) {
+        close(fd);
+        return NULL;
+    }
+
+    t = (telemetry_t *)mmap(NULL, sizeof(telemetry_t), PROT_READ | PROT_WRITE,
+                            MAP_SHARED, fd, 0);
+    close(fd);
+    if (t == MAP_FAILED) {
+        return NULL;
+    }
+
+    memset(t, 0, sizeof(*t));
+    t->version = TELEMETRY_VERSION;
+    t->pid = getpid();
+    __atomic_store_n(&t->magic, TELEMETRY_MAGIC, __ATOMIC_RELEASE);
+
+    return t;
+}
+
+void telemetry_destroy(telemetry_t *t)
+{
+    if (!t) {
+        return;
+    }
+    munmap(t, sizeof(*t));
+    shm_unlink(TELEMETRY_NAME);
+}
+
+const telemetry_t *telemetry_attach(void)
+{
+    telemetry_t *t;
+    struct stat st;
+    int fd;
+
+    fd = shm_open(TELEMETRY_NAME, O_RDONLY, 0);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(telemetry_t)) {
+        close(fd);
+        errno = EINVAL;
+        return NULL;
+    }
+
+    t = (telemetry_t *)mmap(NULL, sizeof(telemetry_t), PROT_READ, MAP_SHARED,
+                            fd, 0);
+    close(fd);
+    if (t == MAP_FAILED) {
+        return NULL;
+    }
+
+    if (__atomic_load_n(&t->magic, __ATOMIC_ACQUIRE) != TELEMETRY_MAGIC ||
+            t->version != TELEMETRY_VERSION) {
+        munmap(t, sizeof(*t));
+        errno = EINVAL;
+        return NULL;
+    }
+
+    return t;
+}
+
+void telemetry_detach(const telemetry_t *t)
+{
+    if (t) {
+        munmap((void *)t, sizeof(*t));
+    }
+}
+
+uint64_t telemetry_now(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * NANOSEC_PER_SEC + (uint64_t)now.tv_nsec;
+}
+
+static void write_begin(volatile uint32_t *seq)
+{
+    __atomic_store_n(seq, *seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static void write_end(volatile uint32_t *seq)
+{
+    __atomic_store_n(seq, *seq + 1, __ATOMIC_RELEASE);
+}
+
+// copy a record out from under its writer, retrying while it is changing
+static void read_record(volatile const uint32_t *seq, void *dst,
+                        const void *src, size_t size)
+{
+    uint32_t before, after;
+
+    do {
+        before = __atomic_load_n(seq, __ATOMIC_ACQUIRE);
+        memcpy(dst, src, size);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        after = __atomic_load_n(seq, __ATOMIC_RELAXED);
+    } while ((before & 1u) || before != after);
+}
+
+void telemetry_watch(telemetry_t *t, unsigned int service, uint64_t period)
+{
+    if (!t || service >= TELEMETRY_MAX_SERVICES) {
+        return;
+    }
+    t->services[service].period = period;
+}
+
+void telemetry_release(telemetry_t *t, unsigned int service)
+{
+    if (!t) {
+        return;
+    }
+    telemetry_service_t *s = &t->services[service];
+    __atomic_store_n(&s->releases, s->releases + 1, __ATOMIC_RELEASE);
+}
+
+void telemetry_job(telemetry_t *t, unsigned int service, uint64_t exec,
+                   uint64_t response)
+{
+    if (!t) {
+        return;
+    }
+    telemetry_service_t *s = &t->services[service];
+
+    write_begin(&s->seq);
+    s->jobs.jobs++;
+    s->jobs.lastExec = exec;
+    if (exec > s->jobs.maxExec) {
+        s->jobs.maxExec = exec;
+    }
+    // 0 when the overload controller lost the release stamp
+    if (response > 0) {
+        s->jobs.lastResponse = response;
+        if (s->period > 0 && response > s->period) {
+            s->jobs.misses++;
+        }
+    }
+    write_end(&s->seq);
+}
+
+void telemetry_frame(telemetry_t *t, uint64_t frame)
+{
+    if (!t) {
+        return;
+    }
+    __atomic_store_n(&t->game.frame, frame, __ATOMIC_RELEASE);
+}
+
+void telemetry_game(telemetry_t *t, const telemetry_game_state_t *state)
+{
+    if (!t) {
+        return;
+    }
+
+    uint64_t updates = t->game.state.updates;
+
+    write_begin(&t->game.seq);
+    t->game.state = *state;
+    t->game.state.updates = updates + 1;
+    write_end(&t->game.seq);
+}
+
+void telemetry_read(const telemetry_t *t, telemetry_snapshot_t *snap)
+{
+    unsigned int i;
+
+    for (i = 0; i < TELEMETRY_MAX_SERVICES; i++) {
+        const telemetry_service_t *s = &t->services[i];
+
+        snap->releases[i] = __atomic_load_n(&s->releases, __ATOMIC_ACQUIRE);
+        snap->periods[i] = s->period;
+        read_record(&s->seq, &snap->jobs[i], &s->jobs, sizeof(s->jobs));
+    }
+
+    snap->frame = __atomic_load_n(&t->game.frame, __ATOMIC_ACQUIRE);
+    read_record(&t->game.seq, &snap->game, &t->game.state,
+                sizeof(t->game.state));
+}
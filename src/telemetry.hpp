@@ -0,0 +1,141 @@
+/**
+   \file telemetry.hpp
+
+   Live telemetry published in a shared memory segment.
+ */
+
+/*
+** Copyright 2018 Benjamin J. Andre.
+** All Rights Reserved.
+**
+** This Source Code Form is subject to the terms of the Mozilla
+** Public License, v. 2.0. If a copy of the MPL was not distributed
+** with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*/
+
+#ifndef RTES_TELEMETRY_H_
+#define RTES_TELEMETRY_H_
+
+#include <stdint.h>
+
+#include <sys/types.h>
+
+/** name of the POSIX shared memory object, /dev/shm/laser-game */
+static const char TELEMETRY_NAME[] = "/laser-game";
+
+static const uint32_t TELEMETRY_MAGIC = 0x4c475431u;   // "LGT1"
+static const uint32_t TELEMETRY_VERSION = 1u;
+
+static const unsigned int TELEMETRY_MAX_SERVICES = 4u;
+static const unsigned int TELEMETRY_MAX_PLAYERS = 8u;
+
+/**
+   Job statistics of one service, written only by that service.
+ */
+typedef struct {
+    uint64_t jobs;
+    uint64_t lastExec;      /*!< ns */
+    uint64_t maxExec;       /*!< ns */
+    uint64_t lastResponse;  /*!< ns from release to completion */
+    uint64_t misses;        /*!< responses longer than the period */
+} telemetry_jobs_t;
+
+typedef struct {
+    volatile uint32_t seq;
+    uint64_t period;             /*!< ns, set before the services start */
+    volatile uint64_t releases;  /*!< written only by the sequencer */
+    telemetry_jobs_t jobs;
+} __attribute__((aligned(64))) telemetry_service_t;
+
+/**
+   Game state, written only by the tracking service.
+ */
+typedef struct {
+    uint64_t updates;
+    int32_t level;
+    uint32_t paused;
+    uint32_t gameOver;
+    uint32_t numPlayers;
+    int32_t scores[TELEMETRY_MAX_PLAYERS];
+    uint32_t joined;        /*!< bit per joined player */
+} telemetry_game_state_t;
+
+typedef struct {
+    volatile uint32_t seq;
+    volatile uint64_t frame;     /*!< frame id, written only by Service_1 */
+    telemetry_game_state_t state;
+} __attribute__((aligned(64))) telemetry_game_t;
+
+/**
+   Layout of the segment. Every record has a single writer and is published
+   with a sequence lock: the writer makes seq odd, updates the record and
+   makes seq even again, and readers retry until they see the same even seq
+   before and after copying. Writers never block and never enter the
+   kernel.
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    pid_t pid;
+    telemetry_service_t services[TELEMETRY_MAX_SERVICES];
+    telemetry_game_t game;
+} telemetry_t;
+
+/**
+   Create, map and zero the segment. Called once during initialization, the
+   memory is locked by mlockall and touched here so the RT threads do not
+   fault on it.
+
+   \return the mapped segment, NULL on failure with errno set
+ */
+telemetry_t *telemetry_create(void);
+
+/**
+   Unmap and unlink the segment.
+ */
+void telemetry_destroy(telemetry_t *t);
+
+/**
+   Map an existing segment read only, for monitors.
+
+   \return the mapped segment, NULL if it does not exist or does not match
+ */
+const telemetry_t *telemetry_attach(void);
+
+void telemetry_detach(const telemetry_t *t);
+
+/**
+   Record the period of a service so jobs can be counted as misses.
+ */
+void telemetry_watch(telemetry_t *t, unsigned int service, uint64_t period);
+
+/** CLOCK_MONOTONIC in ns, a vDSO call rather than a syscall */
+uint64_t telemetry_now(void);
+
+/** sequencer side, count a release of service */
+void telemetry_release(telemetry_t *t, unsigned int service);
+
+/** service side, publish a finished job */
+void telemetry_job(telemetry_t *t, unsigned int service, uint64_t exec,
+                   uint64_t response);
+
+/** frame service side, publish the id of the latest frame */
+void telemetry_frame(telemetry_t *t, uint64_t frame);
+
+/** tracking service side, publish the game state */
+void telemetry_game(telemetry_t *t, const telemetry_game_state_t *state);
+
+/**
+   Consistent snapshot of the records of a segment.
+ */
+typedef struct {
+    uint64_t releases[TELEMETRY_MAX_SERVICES];
+    uint64_t periods[TELEMETRY_MAX_SERVICES];
+    telemetry_jobs_t jobs[TELEMETRY_MAX_SERVICES];
+    uint64_t frame;
+    telemetry_game_state_t game;
+} telemetry_snapshot_t;
+
+void telemetry_read(const telemetry_t *t, telemetry_snapshot_t *snap);
+
+#endif /* RTES_TELEMETRY_H_ */
@@ -0,0 +1,154 @@
+
+/*
+** Copyright 2018 Benjamin J. Andre.
+** All Rights Reserved.
+**
+** This Source Code Form is subject to the terms of the Mozilla
+** Public License, v. 2.0. If a copy of the MPL was not distributed
+** with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*/
+
+// top like monitor for the telemetry segment of a running game.
+//
+// Maps /dev/shm/laser-game read only and redraws at its own rate. It never
+// writes to the segment or signals the game, so it can run at any priority
+// without disturbing the RT threads.
+
+#include <errno.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <getopt.h>
+
+#include "constants.hpp"
+#include "telemetry.hpp"
+
+static const char *SERVICE_NAMES[TELEMETRY_MAX_SERVICES] = {
+    "Sequencer", "Service_1", "Service_2", "Service_3",
+};
+
+static const char *LEVEL_NAMES[] = {
+    "full", "roi", "half_res", "no_blur", "half_render",
+};
+static const int NUM_LEVEL_NAMES = sizeof(LEVEL_NAMES) / sizeof(LEVEL_NAMES[0]);
+
+static double ms(uint64_t ns)
+{
+    return (double)ns / 1000000.0;
+}
+
+static void print_snapshot(pid_t pid, const telemetry_snapshot_t *now,
+                           const telemetry_snapshot_t *prev, double interval,
+                           bool clear)
+{
+    const telemetry_game_state_t *game = &now->game;
+    unsigned int i;
+
+    if (clear) {
+        printf("\033[H\033[2J");
+    }
+
+    printf("laser-game pid %d  frame %llu  %.1f fps\n", (int)pid,
+           (unsigned long long)now->frame,
+           (double)(now->frame - prev->frame) / interval);
+    printf("quality %s  %s%s\n\n",
+           (game->level >= 0 && game->level < NUM_LEVEL_NAMES) ?
+           LEVEL_NAMES[game->level] : "?",
+           game->paused ? "paused " : "", game->gameOver ? "game over" : "");
+
+    printf("%-10s %9s %8s %8s %9s %9s %9s %8s\n", "service", "releases",
+           "rate/s", "backlog", "exec_ms", "max_ms", "resp_ms", "misses");
+    for (i = 0; i < TELEMETRY_MAX_SERVICES; i++) {
+        const telemetry_jobs_t *jobs = &now->jobs[i];
+        uint64_t backlog = (now->releases[i] > jobs->jobs) ?
+                           now->releases[i] - jobs->jobs : 0;
+
+        printf("%-10s %9llu %8.1f %8llu %9.3f %9.3f %9.3f %8llu\n",
+               SERVICE_NAMES[i], (unsigned long long)now->releases[i],
+               (double)(now->releases[i] - prev->releases[i]) / interval,
+               (unsigned long long)backlog, ms(jobs->lastExec),
+               ms(jobs->maxExec), ms(jobs->lastResponse),
+               (unsigned long long)jobs->misses);
+    }
+
+    printf("\nplayer  score  joined\n");
+    for (i = 0; i < game->numPlayers && i < TELEMETRY_MAX_PLAYERS; i++) {
+        printf("%6u %6d  %s\n", i + 1, game->scores[i],
+               (game->joined & (1u << i)) ? "yes" : "no");
+    }
+    fflush(stdout);
+}
+
+static void usage(const char *name)
+{
+    printf("usage: %s [-i ms] [-n count] [-b]\n", name);
+    printf("  -i  refresh interval in ms (default 1000)\n");
+    printf("  -n  exit after count refreshes\n");
+    printf("  -b  batch mode, append instead of redrawing the screen\n");
+}
+
+int main(int argc, char **argv)
+{
+    const telemetry_t *t;
+    telemetry_snapshot_t now, prev;
+    unsigned int interval = 1000;
+    unsigned long long count = 0, n = 0;
+    bool batch = false;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "i:n:bh")) != -1) {
+        switch (opt) {
+        case 'i':
+            interval = atoi(optarg);
+            break;
+        case 'n':
+            count = strtoull(optarg, NULL, 10);
+            break;
+        case 'b':
+            batch = true;
+            break;
+        case 'h':
+            usage(argv[0]);
+            exit(0);
+        default:
+            usage(argv[0]);
+            exit(-1);
+        }
+    }
+
+    if (interval == 0) {
+        usage(argv[0]);
+        exit(-1);
+    }
+
+    t = telemetry_attach();
+    if (!t) {
+        fprintf(stderr, "no telemetry in /dev/shm%s: %s\n", TELEMETRY_NAME,
+                strerror(errno));
+        exit(-1);
+    }
+
+    telemetry_read(t, &prev);
+
+    while (count == 0 || n < count) {
+        usleep(interval * USEC_PER_MSEC);
+
+        // the segment outlives a crashed game, stop once it is gone
+        if (kill(t->pid, 0) < 0 && errno == ESRCH) {
+            printf("laser-game pid %d exited\n", (int)t->pid);
+            break;
+        }
+
+        telemetry_read(t, &now);
+        print_snapshot(t->pid, &now, &prev, interval / 1000.0, !batch);
+        prev = now;
+        n++;
+    }
+
+    telemetry_detach(t);
+    return 0;
+}
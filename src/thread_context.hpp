@@ -18,9 +18,24 @@
 
 #include <stdint.h>
 
+#include "deadline.hpp"
+#include "executor.hpp"
+#include "sequencer.hpp"
+
+typedef struct pipeline_t_ pipeline_t;
+
 typedef struct {
     int threadIdx;
     unsigned long long sequencePeriods;
+    deadline_params_t deadline; /*!< zero runtime keeps SCHED_FIFO */
+    sequencer_sleep_t sleep;    /*!< sequencer only */
+    const char *traceFile;      /*!< csv the thread's plog is appended to */
+    release_group_t *groups;    /*!< sequencer only, groups to release */
+    unsigned int numGroups;
+    executor_t *executor;       /*!< sequencer only, runs the jobs */
+    executor_job_t *jobs;       /*!< sequencer only, best effort jobs */
+    unsigned int numJobs;
+    pipeline_t *pipeline;       /*!< services only */
 } threadParams_t;
 
 
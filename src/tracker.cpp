@@ -0,0 +1,208 @@
+
+/*
+** Copyright 2018 Benjamin J. Andre.
+** All Rights Reserved.
+**
+** This Source Code Form is subject to the terms of the Mozilla
+** Public License, v. 2.0. If a copy of the MPL was not distributed
+** with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*/
+
+#include <stdint.h>
+#include <math.h>
+
+#include <algorithm>
+
+#include "tracker.hpp"
+
+static const unsigned int RESERVE_DETECTIONS = 64u;
+
+// Benedict-Bordner gains, beta = alpha^2 / (2 - alpha), the steady state
+// Kalman gains of a piecewise constant acceleration model. Slightly
+// underdamped, critical damping at this alpha would be beta = 0.25.
+static const float TRACK_ALPHA = 0.75f;
+static const float TRACK_BETA = TRACK_ALPHA * TRACK_ALPHA / (2.0f - TRACK_ALPHA);
+
+static const float NSEC_TO_SEC = 1.0e-9f;
+
+cv::Point2f track_predict(const track_t &track, uint64_t time)
+{
+    uint64_t ahead = (time > track.time) ? time - track.time : 0;
+
+    if (ahead > MAX_PREDICTION_NSEC) {
+        ahead = MAX_PREDICTION_NSEC;
+    }
+    return track.pos + track.vel * ((float)ahead * NSEC_TO_SEC);
+}
+
+// fold a detection into the filter, predicted is the track's position at
+// the detection's capture time
+static void correct(track_t &track, const cv::Point2f &detection,
+                    const cv::Point2f &predicted, uint64_t time)
+{
+    cv::Point2f residual = detection - predicted;
+    float dt = (time > track.time) ? (float)(time - track.time) * NSEC_TO_SEC :
+               0.0f;
+
+    track.error = sqrtf(residual.x * residual.x + residual.y * residual.y);
+    track.pos = predicted + residual * TRACK_ALPHA;
+    if (dt > 0.0f) {
+        track.vel += residual * (TRACK_BETA / dt);
+    }
+    track.time = time;
+}
+
+static void start_track(track_t &track, const cv::Point2f &detection,
+                        uint64_t time)
+{
+    track.active = true;
+    track.updated = true;
+    track.started = true;
+    track.pos = detection;
+    track.vel = cv::Point2f(0.0f, 0.0f);
+    track.time = time;
+    track.error = 0.0f;
+    track.misses = 0;
+}
+
+Tracker::Tracker(unsigned int numTracks, float gate, unsigned int maxMisses)
+    : numTracks(std::min(numTracks, MAX_TRACKS)), gate(gate),
+      maxMisses(maxMisses)
+{
+    unsigned int i;
+    for (i = 0; i < MAX_TRACKS; i++) {
+        tracks[i].active = false;
+        tracks[i].updated = false;
+        tracks[i].started = false;
+        tracks[i].pos = cv::Point2f(0.0f, 0.0f);
+        tracks[i].vel = cv::Point2f(0.0f, 0.0f);
+        tracks[i].time = 0;
+        tracks[i].error = 0.0f;
+        tracks[i].misses = 0;
+    }
+
+    cells.reserve(RESERVE_DETECTIONS);
+    candidates.reserve(RESERVE_DETECTIONS * 9);
+    detAssigned.reserve(RESERVE_DETECTIONS);
+}
+
+int64_t Tracker::cell_key(int cx, int cy) const
+{
+    // arithmetic rather than bitwise, so keys stay ordered by cx within a
+    // row for the negative cells of tracks predicted off the frame
+    return (int64_t)cy * ((int64_t)1 << 32) + cx;
+}
+
+void Tracker::update(const std::vector<cv::Point2f> &detections,
+                     uint64_t time)
+{
+    unsigned int i, j;
+    float gate2 = gate * gate;
+    cv::Point2f predicted[MAX_TRACKS];
+
+    cells.clear();
+    candidates.clear();
+    detAssigned.assign(detections.size(), false);
+
+    for (j = 0; j < detections.size(); j++) {
+        cell_entry_t entry;
+        entry.cell = cell_key((int)floorf(detections[j].x / gate),
+                              (int)floorf(detections[j].y / gate));
+        entry.det = j;
+        cells.push_back(entry);
+    }
+    std::sort(cells.begin(), cells.end(),
+    [](const cell_entry_t &a, const cell_entry_t &b) {
+        return a.cell < b.cell;
+    });
+
+    // gather gated candidates from the 3x3 cell neighbourhood of each track
+    for (i = 0; i < numTracks; i++) {
+        tracks[i].updated = false;
+        tracks[i].started = false;
+        if (!tracks[i].active) {
+            continue;
+        }
+
+        predicted[i] = track_predict(tracks[i], time);
+        int cx = (int)floorf(predicted[i].x / gate);
+        int cy = (int)floorf(predicted[i].y / gate);
+        int dy;
+
+        for (dy = -1; dy <= 1; dy++) {
+            int64_t lo = cell_key(cx - 1, cy + dy);
+            int64_t hi = cell_key(cx + 1, cy + dy);
+            std::vector<cell_entry_t>::const_iterator it =
+                std::lower_bound(cells.begin(), cells.end(), lo,
+            [](const cell_entry_t &e, const int64_t &key) {
+                return e.cell < key;
+            });
+
+            for (; it != cells.end() && it->cell <= hi; ++it) {
+                const cv::Point2f &d = detections[it->det];
+                float dx = d.x - predicted[i].x;
+                float dyy = d.y - predicted[i].y;
+                float dist2 = dx * dx + dyy * dyy;
+
+                if (dist2 <= gate2) {
+                    candidate_t c;
+                    c.dist2 = dist2;
+                    c.track = i;
+                    c.det = it->det;
+                    candidates.push_back(c);
+                }
+            }
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(),
+    [](const candidate_t &a, const candidate_t &b) {
+        return a.dist2 < b.dist2;
+    });
+
+    // closest pairs first, each track and detection used at most once
+    for (i = 0; i < candidates.size(); i++) {
+        const candidate_t &c = candidates[i];
+        if (tracks[c.track].updated || detAssigned[c.det]) {
+            continue;
+        }
+        tracks[c.track].updated = true;
+        correct(tracks[c.track], detections[c.det], predicted[c.track], time);
+        tracks[c.track].misses = 0;
+        detAssigned[c.det] = true;
+    }
+
+    for (i = 0; i < numTracks; i++) {
+        if (tracks[i].active && !tracks[i].updated) {
+            tracks[i].misses++;
+            if (tracks[i].misses > maxMisses) {
+                tracks[i].active = false;
+            }
+        }
+    }
+
+    // remaining detections start new tracks in the lowest free slots
+    i = 0;
+    for (j = 0; j < detections.size(); j++) {
+        if (detAssigned[j]) {
+            continue;
+        }
+        while (i < numTracks && tracks[i].active) {
+            i++;
+        }
+        if (i == numTracks) {
+            break;
+        }
+        start_track(tracks[i], detections[j], time);
+        detAssigned[j] = true;
+    }
+}
+
+unsigned int Tracker::size() const
+{
+    return numTracks;
+}
+
+const track_t &Tracker::track(unsigned int i) const
+{
+    return tracks[i];
+}
@@ -0,0 +1,106 @@
+/**
+   \file tracker.hpp
+
+   Multi-target laser tracking with gated nearest neighbour association.
+ */
+
+/*
+** Copyright 2018 Benjamin J. Andre.
+** All Rights Reserved.
+**
+** This Source Code Form is subject to the terms of the Mozilla
+** Public License, v. 2.0. If a copy of the MPL was not distributed
+** with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*/
+
+#ifndef RTES_TRACKER_H_
+#define RTES_TRACKER_H_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+static const unsigned int MAX_TRACKS = 8u;
+
+/** farthest ahead of its last detection a track is extrapolated */
+static const uint64_t MAX_PREDICTION_NSEC = 250000000u;
+
+/**
+   State of one laser track. Track i always drives player i.
+ */
+typedef struct {
+    bool active;          /*!< track currently owns a laser */
+    bool updated;         /*!< a detection was associated this frame */
+    bool started;         /*!< the track was started this frame */
+    cv::Point2f pos;      /*!< filtered position at time */
+    cv::Point2f vel;      /*!< filtered velocity, pixels per second */
+    uint64_t time;        /*!< capture time of the last detection, ns */
+    float error;          /*!< distance of the last detection from its
+                               prediction */
+    unsigned int misses;  /*!< consecutive frames without a detection */
+} track_t;
+
+/**
+   Constant velocity extrapolation of a track to time, capped at
+   MAX_PREDICTION_NSEC after its last detection.
+ */
+cv::Point2f track_predict(const track_t &track, uint64_t time);
+
+/**
+   Associates each frame's blob centers to a fixed set of tracks.
+
+   Detections are bucketed into a sorted grid with cells the size of the gate,
+   so a track only considers detections in its 3x3 neighbourhood. Candidate
+   pairs inside the gate are sorted by distance and assigned greedily, giving
+   O((N + M) log M) per frame for N tracks and M detections. Unassigned
+   detections start new tracks in free slots and tracks that miss more than
+   maxMisses frames in a row are released.
+
+   Each track carries a constant velocity alpha-beta filter with
+   Benedict-Bordner gains, the steady state form of a Kalman filter for
+   that model. Tracks are gated at their
+   position predicted for the frame's capture time, so fast lasers stay
+   associated, and the filtered state lets the renderer extrapolate.
+ */
+class Tracker
+{
+  public:
+    Tracker(unsigned int numTracks, float gate, unsigned int maxMisses);
+
+    /**
+       Associate the detections of a frame captured at time (ns, any
+       monotonic clock) and update the tracks' motion.
+     */
+    void update(const std::vector<cv::Point2f> &detections, uint64_t time);
+
+    unsigned int size() const;
+    const track_t &track(unsigned int i) const;
+
+  private:
+    typedef struct {
+        int64_t cell;
+        unsigned int det;
+    } cell_entry_t;
+
+    typedef struct {
+        float dist2;
+        unsigned int track;
+        unsigned int det;
+    } candidate_t;
+
+    int64_t cell_key(int cx, int cy) const;
+
+    unsigned int numTracks;
+    float gate;
+    unsigned int maxMisses;
+    track_t tracks[MAX_TRACKS];
+
+    // scratch space, reused every frame to avoid allocating in the RT loop
+    std::vector<cell_entry_t> cells;
+    std::vector<candidate_t> candidates;
+    std::vector<bool> detAssigned;
+};
+
+#endif /* RTES_TRACKER_H_ */
@@ -0,0 +1,86 @@
+
+/*
+** Copyright 2018 Benjamin J. Andre.
+** All Rights Reserved.
+**
+** This Source Code Form is subject to the terms of the Mozilla
+** Public License, v. 2.0. If a copy of the MPL was not distributed
+** with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*/
+
+#include <alloca.h>
+#include <malloc.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+
+#include "warmup.hpp"
+
+int lock_memory(void)
+{
+    mallopt(M_TRIM_THRESHOLD, -1);
+    mallopt(M_MMAP_MAX, 0);
+    mallopt(M_ARENA_MAX, 1);
+
+    return mlockall(MCL_CURRENT | MCL_FUTURE);
+}
+
+void prefault_heap(size_t bytes)
+{
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    volatile char *block = (volatile char *)malloc(bytes);
+    size_t i;
+
+    if (!block) {
+        return;
+    }
+    for (i = 0; i < bytes; i += page) {
+        block[i] = 0;
+    }
+    free((void *)block);
+}
+
+void __attribute__((noinline)) prefault_stack(size_t bytes)
+{
+    volatile char *stack = (volatile char *)alloca(bytes);
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t i;
+
+    for (i = 0; i < bytes; i += page) {
+        stack[i] = 0;
+    }
+}
+
+static void get_faults(int who, fault_count_t *faults)
+{
+    struct rusage usage;
+
+    getrusage(who, &usage);
+    faults->minor = usage.ru_minflt;
+    faults->major = usage.ru_majflt;
+}
+
+void get_process_faults(fault_count_t *faults)
+{
+    get_faults(RUSAGE_SELF, faults);
+}
+
+void get_thread_faults(fault_count_t *faults)
+{
+    get_faults(RUSAGE_THREAD, faults);
+}
+
+fault_count_t fault_delta(const fault_count_t *before,
+                          const fault_count_t *after)
+{
+    fault_count_t delta;
+
+    delta.minor = after->minor - before->minor;
+    delta.major = after->major - before->major;
+    return delta;
+}
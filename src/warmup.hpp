@@ -0,0 +1,65 @@
+/**
+   \file warmup.hpp
+
+   Memory locking, prefaulting and page fault accounting for the warm-up
+   phase before the sequencer starts.
+ */
+
+/*
+** Copyright 2018 Benjamin J. Andre.
+** All Rights Reserved.
+**
+** This Source Code Form is subject to the terms of the Mozilla
+** Public License, v. 2.0. If a copy of the MPL was not distributed
+** with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+*/
+
+#ifndef RTES_WARMUP_H_
+#define RTES_WARMUP_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+    long minor;
+    long major;
+} fault_count_t;
+
+/**
+   Lock current and future pages and keep freed heap memory in the process
+
+   Malloc is limited to a single arena that is never trimmed and never uses
+   mmap, so memory prefaulted by prefault_heap() is what later allocations
+   from every thread reuse.
+
+   \return 0 on success, -1 if mlockall failed (usually missing privileges)
+ */
+int lock_memory(void);
+
+/**
+   Touch every page of a heap block of the given size and release it
+ */
+void prefault_heap(size_t bytes);
+
+/**
+   Touch the given number of bytes of the calling thread's stack
+ */
+void prefault_stack(size_t bytes);
+
+/**
+   Page faults of the whole process so far
+ */
+void get_process_faults(fault_count_t *faults);
+
+/**
+   Page faults of the calling thread so far
+ */
+void get_thread_faults(fault_count_t *faults);
+
+/**
+   Difference of two fault counts, after - before
+ */
+fault_count_t fault_delta(const fault_count_t *before,
+                          const fault_count_t *after);
+
+#endif /* RTES_WARMUP_H_ */